@@ -0,0 +1,206 @@
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "raylib.h"
+
+// prepares the images in resources/ at build time: embed_assets <resources dir> <output dir>
+//  - every sprite is packed into one atlas, described by sprite_atlas.h (sprite ids and their rectangles)
+//  - embedded_assets.c defines the atlas and the background already decoded, as `const Image embedded_<name>`
+//    ready for LoadTextureFromImage(), so the game starts without file I/O or image decoding. It is compiled into an
+//    object of its own, main.c only declares the images
+
+#define BYTES_PER_LINE 16
+#define ATLAS_WIDTH 512
+// every sprite is surrounded by a copy of its edge pixels, so filtering at the edges never samples a neighbour
+#define EXTRUDE 1
+
+#define SNAKE_PIECE_SIZE 64
+
+// the pieces of snake-graphics.png, as cells of SNAKE_PIECE_SIZE
+typedef struct
+{
+    const char *name;
+    int x;
+    int y;
+} SnakePiece;
+
+static const SnakePiece snake_pieces[] = {
+    {"SNAKE_HEAD_UP", 3, 0},   {"SNAKE_HEAD_DOWN", 4, 1}, {"SNAKE_HEAD_LEFT", 3, 1}, {"SNAKE_HEAD_RIGHT", 4, 0},
+    {"SNAKE_TAIL_DOWN", 4, 3}, {"SNAKE_TAIL_UP", 3, 2},   {"SNAKE_TAIL_RIGHT", 4, 2}, {"SNAKE_TAIL_LEFT", 3, 3},
+    {"SNAKE_BODY_45", 2, 2},   {"SNAKE_BODY_90", 2, 1},   {"SNAKE_BODY_135", 2, 0},  {"SNAKE_BODY_180", 1, 0},
+    {"SNAKE_BODY_225", 0, 0},  {"SNAKE_BODY_315", 0, 1},
+};
+
+typedef struct
+{
+    const char *name;
+    Image image;
+    Rectangle rect;
+} Sprite;
+
+typedef struct
+{
+    Sprite *items;
+    size_t count;
+    size_t capacity;
+} Sprites;
+
+static bool load_rgba(const char *path, Image *image)
+{
+    *image = LoadImage(path);
+    if (!IsImageValid(*image))
+    {
+        nob_log(NOB_ERROR, "could not decode %s", path);
+        return false;
+    }
+
+    ImageFormat(image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    return true;
+}
+
+static Color *pixel_at(Image image, int x, int y)
+{
+    return &((Color *)image.data)[y * image.width + x];
+}
+
+// shelf packing in the order given, which is good enough for a handful of sprites of (nearly) the same size
+static Image pack_sprites(Sprites *sprites)
+{
+    int x = 0;
+    int y = 0;
+    int shelf_height = 0;
+
+    nob_da_foreach(Sprite, sprite, sprites)
+    {
+        int width = sprite->image.width + 2 * EXTRUDE;
+        int height = sprite->image.height + 2 * EXTRUDE;
+
+        if (x + width > ATLAS_WIDTH)
+        {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+
+        sprite->rect = (Rectangle){x + EXTRUDE, y + EXTRUDE, sprite->image.width, sprite->image.height};
+        x += width;
+        shelf_height = shelf_height > height ? shelf_height : height;
+    }
+
+    Image atlas = GenImageColor(ATLAS_WIDTH, y + shelf_height, BLANK);
+
+    nob_da_foreach(Sprite, sprite, sprites)
+    {
+        int left = (int)sprite->rect.x;
+        int top = (int)sprite->rect.y;
+
+        for (int dy = -EXTRUDE; dy < sprite->image.height + EXTRUDE; dy++)
+        {
+            for (int dx = -EXTRUDE; dx < sprite->image.width + EXTRUDE; dx++)
+            {
+                int source_x = dx < 0 ? 0 : dx >= sprite->image.width ? sprite->image.width - 1 : dx;
+                int source_y = dy < 0 ? 0 : dy >= sprite->image.height ? sprite->image.height - 1 : dy;
+                *pixel_at(atlas, left + dx, top + dy) = *pixel_at(sprite->image, source_x, source_y);
+            }
+        }
+    }
+
+    return atlas;
+}
+
+static void append_embedded_image(Nob_String_Builder *sb, const char *name, Image image)
+{
+    int size = GetPixelDataSize(image.width, image.height, image.format);
+    const unsigned char *pixels = image.data;
+
+    nob_sb_appendf(sb, "static const unsigned char embedded_%s_pixels[%d] = {", name, size);
+    for (int i = 0; i < size; i++)
+    {
+        if (i % BYTES_PER_LINE == 0)
+        {
+            nob_sb_append_cstr(sb, "\n    ");
+        }
+        nob_sb_appendf(sb, "0x%02x,", pixels[i]);
+    }
+    nob_sb_append_cstr(sb, "\n};\n");
+
+    nob_sb_appendf(sb,
+                   "const Image embedded_%s = {.data = (void *)embedded_%s_pixels, .width = %d, .height = %d, "
+                   ".mipmaps = 1, .format = %d};\n\n",
+                   name, name, image.width, image.height, image.format);
+}
+
+static void append_sprite_table(Nob_String_Builder *sb, const Sprites *sprites)
+{
+    nob_sb_append_cstr(sb, "typedef enum\n{\n");
+    nob_da_foreach(Sprite, sprite, sprites)
+    {
+        nob_sb_appendf(sb, "    SPRITE_%s,\n", sprite->name);
+    }
+    nob_sb_append_cstr(sb, "    SPRITE_COUNT,\n} SpriteId;\n\n");
+
+    nob_sb_append_cstr(sb, "static const Rectangle sprite_rects[SPRITE_COUNT] = {\n");
+    nob_da_foreach(Sprite, sprite, sprites)
+    {
+        nob_sb_appendf(sb, "    [SPRITE_%s] = {%.0f, %.0f, %.0f, %.0f},\n", sprite->name, sprite->rect.x, sprite->rect.y,
+                       sprite->rect.width, sprite->rect.height);
+    }
+    nob_sb_append_cstr(sb, "};\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = nob_shift(argv, argc);
+    if (argc != 2)
+    {
+        nob_log(NOB_ERROR, "usage: %s <resources dir> <output dir>", program_name);
+        return 1;
+    }
+
+    const char *resources_dir = nob_shift(argv, argc);
+    const char *output_dir = nob_shift(argv, argc);
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    Image snake_graphics;
+    Image apple;
+    Image background;
+    if (!load_rgba(nob_temp_sprintf("%s/snake-graphics.png", resources_dir), &snake_graphics) ||
+        !load_rgba(nob_temp_sprintf("%s/apple.png", resources_dir), &apple) ||
+        !load_rgba(nob_temp_sprintf("%s/bg.jpg", resources_dir), &background))
+    {
+        return 1;
+    }
+    // nothing is drawn through the background's alpha
+    ImageFormat(&background, PIXELFORMAT_UNCOMPRESSED_R8G8B8);
+
+    Sprites sprites = {0};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(snake_pieces); i++)
+    {
+        Rectangle cell = {snake_pieces[i].x * SNAKE_PIECE_SIZE, snake_pieces[i].y * SNAKE_PIECE_SIZE, SNAKE_PIECE_SIZE,
+                          SNAKE_PIECE_SIZE};
+        nob_da_append(&sprites, ((Sprite){.name = snake_pieces[i].name, .image = ImageFromImage(snake_graphics, cell)}));
+    }
+    nob_da_append(&sprites, ((Sprite){.name = "APPLE", .image = apple}));
+
+    Image atlas = pack_sprites(&sprites);
+
+    Nob_String_Builder sb = {0};
+
+    nob_sb_append_cstr(&sb, "// generated by embed_assets.c, do not edit\n\n");
+    append_sprite_table(&sb, &sprites);
+    if (!nob_write_entire_file(nob_temp_sprintf("%s/sprite_atlas.h", output_dir), sb.items, sb.count))
+    {
+        return 1;
+    }
+
+    sb.count = 0;
+    nob_sb_append_cstr(&sb, "// generated by embed_assets.c, do not edit\n\n#include \"raylib.h\"\n\n");
+    append_embedded_image(&sb, "sprites", atlas);
+    append_embedded_image(&sb, "background", background);
+    if (!nob_write_entire_file(nob_temp_sprintf("%s/embedded_assets.c", output_dir), sb.items, sb.count))
+    {
+        return 1;
+    }
+
+    return 0;
+}
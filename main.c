@@ -1,9 +1,46 @@
+// debug builds count every allocation and free going through nob, per thread, so the simulation can check that a
+// step makes none
+#ifndef NDEBUG
+#include <stdlib.h>
+
+static _Thread_local size_t heap_operations = 0;
+
+static void *counted_realloc(void *pointer, size_t size)
+{
+    heap_operations++;
+    return realloc(pointer, size);
+}
+
+static void counted_free(void *pointer)
+{
+    if (pointer != NULL)
+    {
+        heap_operations++;
+    }
+    free(pointer);
+}
+
+#define NOB_REALLOC counted_realloc
+#define NOB_FREE counted_free
+#endif
+
 #define NOB_IMPLEMENTATION
 #include "nob.h"
 #include "raylib.h"
 #include "raymath.h"
-
-#define RESOURCES_DIR "resources/"
+#include "rlgl.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// generated by nob (see embed_assets.c), so the game is only built through nob: the sprite ids and where they are in
+// the packed sprite atlas, and the atlas and the background already decoded into the binary (embedded_assets.c,
+// compiled on its own)
+#include "sprite_atlas.h"
+extern const Image embedded_sprites;
+extern const Image embedded_background;
 
 #define max(a, b) (a) > (b) ? (a) : (b)
 #define min(a, b) (a) < (b) ? (a) : (b)
@@ -24,40 +61,95 @@ typedef struct
 typedef struct
 {
     Body body;
+    // the body as it was before the last tick, segments are drawn moving from there towards body
+    Body previous_body;
     Vector2 direction;
 } Snake;
 
+#define NS_PER_MS 1000000ull
+#define NS_PER_SECOND 1000000000ull
+
+// fixed step clock: time is carried over between ticks instead of being rounded away, and when it falls too far
+// behind only max_catch_up ticks run back to back, the rest of the backlog is dropped and accounted for
 typedef struct
 {
-    uint16_t ms_to_trigger;
-    uint16_t ms_accumulated;
+    uint64_t ns_to_trigger;
+    uint64_t ns_accumulated;
+    uint32_t max_catch_up;
+    uint32_t catch_up_left;
+    uint64_t ticks;
+    // how long after its nominal time the last tick actually ran
+    uint64_t ns_late;
+    uint64_t ns_late_max;
+    // time that was never simulated because of max_catch_up
+    uint64_t ns_dropped;
 } Accumulator;
 
+#ifndef ROWS
 #define ROWS 15
+#endif
+
+#ifndef COLUMNS
 #define COLUMNS 25
+#endif
+
+// a snake covering the whole board, the most any body ever holds
+#define BODY_CAPACITY (ROWS * COLUMNS)
+
+// always 0 without the counter
+static size_t heap_operations_count(void)
+{
+#ifndef NDEBUG
+    return heap_operations;
+#else
+    return 0;
+#endif
+}
 
-static bool accumulator_tick(Accumulator *accumulator, float dt)
+static void accumulator_advance(Accumulator *accumulator, uint64_t dt_ns)
 {
-    float add = dt * 1000.0;
+    accumulator->ns_accumulated += dt_ns;
+    accumulator->catch_up_left = accumulator->max_catch_up;
+}
 
-    if (accumulator->ms_accumulated + add > accumulator->ms_to_trigger)
+// call until it returns false, every call consumes one due tick
+static bool accumulator_tick(Accumulator *accumulator)
+{
+    if (accumulator->ns_accumulated < accumulator->ns_to_trigger)
     {
-        accumulator->ms_accumulated = 0;
-        return true;
+        return false;
     }
 
-    accumulator->ms_accumulated += add;
-    return false;
+    if (accumulator->catch_up_left == 0)
+    {
+        uint64_t behind = accumulator->ns_accumulated - accumulator->ns_accumulated % accumulator->ns_to_trigger;
+        accumulator->ns_accumulated -= behind;
+        accumulator->ns_dropped += behind;
+        return false;
+    }
+
+    accumulator->catch_up_left--;
+    accumulator->ns_accumulated -= accumulator->ns_to_trigger;
+    accumulator->ticks++;
+
+    accumulator->ns_late = accumulator->ns_accumulated;
+    accumulator->ns_late_max = max(accumulator->ns_late_max, accumulator->ns_late);
+
+    return true;
 }
 
 static void accumulator_reset(Accumulator *accumulator)
 {
-    accumulator->ms_accumulated = 0;
+    accumulator->ns_accumulated = 0;
+    accumulator->ticks = 0;
+    accumulator->ns_late = 0;
+    accumulator->ns_late_max = 0;
+    accumulator->ns_dropped = 0;
 }
 
 static float accumulator_progress(const Accumulator accumulator)
 {
-    return min((float)accumulator.ms_accumulated / (float)accumulator.ms_to_trigger, 1.0f);
+    return min((float)accumulator.ns_accumulated / (float)accumulator.ns_to_trigger, 1.0f);
 }
 
 static float linear_interpolation(float progress, float from, float to)
@@ -66,10 +158,10 @@ static float linear_interpolation(float progress, float from, float to)
     return from + (progress * diff);
 }
 
-static uint8_t calculate_diameter(void)
+static uint8_t calculate_diameter_for(int width, int height)
 {
-    float available_width = GetScreenWidth() * .90;
-    float available_height = GetScreenHeight() * .90;
+    float available_width = width * .90;
+    float available_height = height * .90;
 
     float width_diameter = floor(available_width / COLUMNS);
     float height_diameter = floor(available_height / ROWS);
@@ -77,165 +169,142 @@ static uint8_t calculate_diameter(void)
     return min(width_diameter, height_diameter);
 }
 
-static void draw_food(const Food *food, Accumulator *animation_accumulator, const Texture2D *texture, uint8_t diameter,
-                      Vector2 offset, float dt)
+static Vector2 calculate_offset_for(int width, int height, uint8_t diameter)
 {
-    Vector2 top_left_corner = Vector2Add(Vector2Scale(food->position, diameter), offset);
-    Rectangle source_rec = {0.0f, 0.0f, (float)texture->width, (float)texture->height};
-    Rectangle dest_rec = {top_left_corner.x, top_left_corner.y, diameter, diameter};
-    accumulator_tick(animation_accumulator, dt);
-    float scale = linear_interpolation(accumulator_progress(*animation_accumulator), 1.0f, 1.10f);
-    dest_rec.height *= scale;
-    dest_rec.width *= scale;
-    DrawTexturePro(*texture, source_rec, dest_rec, Vector2Zero(), 0.0f, WHITE);
+    float used_x = diameter * COLUMNS;
+    float used_y = diameter * ROWS;
+
+    return (Vector2){
+        .x = (width - used_x) / 2,
+        .y = (height - used_y) / 2,
+    };
 }
 
+// where the board is for one window (or framebuffer) size, recomputed only when that size changes
 typedef struct
 {
-    u_int8_t x;
-    u_int8_t y;
-} AtlasPiece;
+    int width;
+    int height;
+    uint8_t diameter;
+    Vector2 offset;
+    // placed by layout_follow() instead of fitting the whole board into the size
+    bool camera;
+    // the top left corner of every column and row in pixels
+    float column_x[COLUMNS];
+    float row_y[ROWS];
+} Layout;
+
+static void layout_place_cells(Layout *layout)
+{
+    for (int column = 0; column < COLUMNS; column++)
+    {
+        layout->column_x[column] = column * layout->diameter + layout->offset.x;
+    }
+    for (int row = 0; row < ROWS; row++)
+    {
+        layout->row_y[row] = row * layout->diameter + layout->offset.y;
+    }
+}
+
+// returns true when the size changed
+static bool layout_update(Layout *layout, int width, int height)
+{
+    if (!layout->camera && layout->width == width && layout->height == height)
+    {
+        return false;
+    }
 
-typedef struct
+    layout->width = width;
+    layout->height = height;
+    layout->diameter = calculate_diameter_for(width, height);
+    layout->offset = calculate_offset_for(width, height, layout->diameter);
+    layout->camera = false;
+    layout_place_cells(layout);
+
+    return true;
+}
+
+// a board smaller than the window stays in the middle, a bigger one scrolls but never past its edges
+static float layout_follow_axis(int size, int board_size, float center)
 {
-    u_int8_t width;
-    u_int8_t height;
-    AtlasPiece pieces[];
-} AtlasDefinition;
-
-enum
-{
-    SNAKE_HEAD_UP,
-    SNAKE_HEAD_DOWN,
-    SNAKE_HEAD_LEFT,
-    SNAKE_HEAD_RIGHT,
-    SNAKE_TAIL_DOWN,
-    SNAKE_TAIL_UP,
-    SNAKE_TAIL_RIGHT,
-    SNAKE_TAIL_LEFT,
-    SNAKE_BODY_45,
-    SNAKE_BODY_90,
-    SNAKE_BODY_135,
-    SNAKE_BODY_180,
-    SNAKE_BODY_225,
-    SNAKE_BODY_315,
-};
+    if (board_size <= size)
+    {
+        return (size - board_size) / 2;
+    }
 
-static AtlasDefinition snake_atlas_definition = {
-    .height = 64,
-    .width = 64,
-    .pieces =
-        {
-            [SNAKE_HEAD_UP] =
-                {
-                    .x = 3,
-                    .y = 0,
-                },
-            [SNAKE_HEAD_DOWN] =
-                {
-                    .x = 4,
-                    .y = 1,
-                },
-            [SNAKE_HEAD_LEFT] =
-                {
-                    .x = 3,
-                    .y = 1,
-                },
-            [SNAKE_HEAD_RIGHT] =
-                {
-                    .x = 4,
-                    .y = 0,
-                },
-            [SNAKE_TAIL_DOWN] =
-                {
-                    .x = 4,
-                    .y = 3,
-                },
-            [SNAKE_TAIL_UP] =
-                {
-                    .x = 3,
-                    .y = 2,
-                },
-            [SNAKE_TAIL_RIGHT] =
-                {
-                    .x = 4,
-                    .y = 2,
-                },
-            [SNAKE_TAIL_LEFT] =
-                {
-                    .x = 3,
-                    .y = 3,
-                },
-            [SNAKE_BODY_45] =
-                {
-                    .x = 2,
-                    .y = 2,
-                },
-            [SNAKE_BODY_90] =
-                {
-                    .x = 2,
-                    .y = 1,
-                },
-            [SNAKE_BODY_135] =
-                {
-                    .x = 2,
-                    .y = 0,
-                },
-            [SNAKE_BODY_180] =
-                {
-                    .x = 1,
-                    .y = 0,
-                },
-            [SNAKE_BODY_225] =
-                {
-                    .x = 0,
-                    .y = 0,
-                },
-            [SNAKE_BODY_315] =
-                {
-                    .x = 0,
-                    .y = 1,
-                },
-        },
-};
+    return Clamp(floorf(size / 2.0f - center), size - board_size, 0.0f);
+}
+
+// cells of a fixed diameter with center (in cells) in the middle of the window, returns true when the board moved
+static bool layout_follow(Layout *layout, int width, int height, uint8_t diameter, Vector2 center)
+{
+    Vector2 offset = {
+        .x = layout_follow_axis(width, COLUMNS * diameter, (center.x + 0.5f) * diameter),
+        .y = layout_follow_axis(height, ROWS * diameter, (center.y + 0.5f) * diameter),
+    };
+
+    if (layout->camera && layout->width == width && layout->height == height && layout->diameter == diameter &&
+        Vector2Equals(layout->offset, offset))
+    {
+        return false;
+    }
+
+    layout->width = width;
+    layout->height = height;
+    layout->diameter = diameter;
+    layout->offset = offset;
+    layout->camera = true;
+    layout_place_cells(layout);
+
+    return true;
+}
+
+// the top left corner of something moving from one cell to another, progress of the way there
+static Vector2 layout_position(const Layout *layout, Vector2 from, Vector2 to, float progress)
+{
+    assert(from.x >= 0 && from.x < COLUMNS && from.y >= 0 && from.y < ROWS);
+    assert(to.x >= 0 && to.x < COLUMNS && to.y >= 0 && to.y < ROWS);
+
+    return (Vector2){
+        .x = Lerp(layout->column_x[(int)from.x], layout->column_x[(int)to.x], progress),
+        .y = Lerp(layout->row_y[(int)from.y], layout->row_y[(int)to.y], progress),
+    };
+}
+
+// snapped to whole pixels, so the pulse only needs a redraw when its size on screen actually changes
+static int food_size(const Accumulator *animation_accumulator, uint8_t diameter)
+{
+    float scale = linear_interpolation(accumulator_progress(*animation_accumulator), 1.0f, 1.10f);
+    return (int)floorf(diameter * scale);
+}
 
 static const Vector2 DIRECTION_UP = (Vector2){0, -1};
 static const Vector2 DIRECTION_DOWN = (Vector2){0, 1};
 static const Vector2 DIRECTION_LEFT = (Vector2){-1, 0};
 static const Vector2 DIRECTION_RIGHT = (Vector2){1, 0};
 
-static Rectangle rectangle_for_snake_body_part(const Snake *snake, const AtlasDefinition *snake_atlas,
-                                               const Vector2 *segment)
+static SpriteId sprite_for_snake_body_part(const Snake *snake, const Vector2 *segment)
 {
 #define IS_TAIL(part) part == &snake->body.items[snake->body.count - 1]
 #define IS_HEAD(part) part == &snake->body.items[0]
 
-// changes to avoid bleeding
-//  + 0.5f
-// - 1.0f
-#define TO_RECTANGLE(atlas_piece_index)                                                                                \
-    (Rectangle){.x = snake_atlas->pieces[atlas_piece_index].x * snake_atlas->width + 0.5f,                             \
-                .y = snake_atlas->pieces[atlas_piece_index].y * snake_atlas->height + 0.5f,                            \
-                .width = snake_atlas->width - 1.0f,                                                                    \
-                .height = snake_atlas->height - 1.0f}
-
     if (IS_HEAD(segment))
     {
         if (Vector2Equals(snake->direction, DIRECTION_UP))
         {
-            return TO_RECTANGLE(SNAKE_HEAD_UP);
+            return SPRITE_SNAKE_HEAD_UP;
         }
         if (Vector2Equals(snake->direction, DIRECTION_DOWN))
         {
-            return TO_RECTANGLE(SNAKE_HEAD_DOWN);
+            return SPRITE_SNAKE_HEAD_DOWN;
         }
         if (Vector2Equals(snake->direction, DIRECTION_LEFT))
         {
-            return TO_RECTANGLE(SNAKE_HEAD_LEFT);
+            return SPRITE_SNAKE_HEAD_LEFT;
         }
         if (Vector2Equals(snake->direction, DIRECTION_RIGHT))
         {
-            return TO_RECTANGLE(SNAKE_HEAD_RIGHT);
+            return SPRITE_SNAKE_HEAD_RIGHT;
         }
     }
 
@@ -248,17 +317,17 @@ static Rectangle rectangle_for_snake_body_part(const Snake *snake, const AtlasDe
 
         if (Vector2Equals(diff, DIRECTION_UP))
         {
-            return TO_RECTANGLE(SNAKE_TAIL_DOWN);
+            return SPRITE_SNAKE_TAIL_DOWN;
         }
         if (Vector2Equals(diff, DIRECTION_DOWN))
         {
-            return TO_RECTANGLE(SNAKE_TAIL_UP);
+            return SPRITE_SNAKE_TAIL_UP;
         }
         if (Vector2Equals(diff, DIRECTION_LEFT))
         {
-            return TO_RECTANGLE(SNAKE_TAIL_RIGHT);
+            return SPRITE_SNAKE_TAIL_RIGHT;
         }
-        return TO_RECTANGLE(SNAKE_TAIL_LEFT);
+        return SPRITE_SNAKE_TAIL_LEFT;
     }
 
     const Vector2 *towards_head = segment - 1;
@@ -266,12 +335,12 @@ static Rectangle rectangle_for_snake_body_part(const Snake *snake, const AtlasDe
 
     if (segment->x == towards_head->x && segment->x == towards_tail->x)
     {
-        return TO_RECTANGLE(SNAKE_BODY_90);
+        return SPRITE_SNAKE_BODY_90;
     }
 
     if (segment->y == towards_head->y && segment->y == towards_tail->y)
     {
-        return TO_RECTANGLE(SNAKE_BODY_180);
+        return SPRITE_SNAKE_BODY_180;
     }
 
     Vector2 head_diff = Vector2Subtract(*segment, *towards_head);
@@ -282,341 +351,3419 @@ static Rectangle rectangle_for_snake_body_part(const Snake *snake, const AtlasDe
 
     if (HEAD_TO_TAIL(DIRECTION_RIGHT, DIRECTION_UP) || HEAD_TO_TAIL(DIRECTION_DOWN, DIRECTION_LEFT))
     {
-        return TO_RECTANGLE(SNAKE_BODY_45);
+        return SPRITE_SNAKE_BODY_45;
     }
 
     if (HEAD_TO_TAIL(DIRECTION_RIGHT, DIRECTION_DOWN) || HEAD_TO_TAIL(DIRECTION_UP, DIRECTION_LEFT))
     {
-        return TO_RECTANGLE(SNAKE_BODY_135);
+        return SPRITE_SNAKE_BODY_135;
     }
 
     if (HEAD_TO_TAIL(DIRECTION_DOWN, DIRECTION_RIGHT) || HEAD_TO_TAIL(DIRECTION_LEFT, DIRECTION_UP))
     {
-        return TO_RECTANGLE(SNAKE_BODY_315);
+        return SPRITE_SNAKE_BODY_315;
     }
 
     if (HEAD_TO_TAIL(DIRECTION_UP, DIRECTION_RIGHT) || HEAD_TO_TAIL(DIRECTION_LEFT, DIRECTION_DOWN))
     {
-        return TO_RECTANGLE(SNAKE_BODY_225);
+        return SPRITE_SNAKE_BODY_225;
     }
 
-    NOB_UNREACHABLE("rectangle_for_snake_body_part");
+    NOB_UNREACHABLE("sprite_for_snake_body_part");
 
 #undef IS_TAIL
 #undef IS_HEAD
 #undef HEAD_TO_TAIL
-#undef TO_RECTANGLE
 }
 
-static void draw_snake(const Snake *snake, const Texture2D *snake_atlas, const AtlasDefinition *snake_atlas_defitinion,
-                       uint8_t diameter, Vector2 offset)
+// the snake can at most fill the whole board, plus the food, so a batch with one quad per cell never has to flush
+// midway
+static rlRenderBatch load_board_batch(void)
 {
-    nob_da_foreach(Vector2, segment, &snake->body)
-    {
-        Vector2 top_left_corner = Vector2Add(Vector2Scale(*segment, diameter), offset);
-        Rectangle dest_rec = {top_left_corner.x, top_left_corner.y, diameter, diameter};
-        Rectangle source_rec = rectangle_for_snake_body_part(snake, snake_atlas_defitinion, segment);
-        DrawTexturePro(*snake_atlas, source_rec, dest_rec, Vector2Zero(), 0.0f, ORANGE);
-    }
+    return rlLoadRenderBatch(1, COLUMNS * ROWS + 1);
 }
 
-static void draw_borders(Vector2 offset)
+static void push_sprite_quad(const Texture2D *sprites, SpriteId sprite, float x, float y, float size)
 {
-    DrawRectangle(0, 0, GetScreenWidth(), offset.y, BLACK);
-    DrawRectangle(0, GetScreenHeight() - offset.y, GetScreenWidth(), offset.y, BLACK);
-    DrawRectangle(0, 0, offset.x, GetScreenHeight(), BLACK);
-    DrawRectangle(GetScreenWidth() - offset.x, 0, offset.x, GetScreenHeight(), BLACK);
+    // until the atlas is loaded every sprite is a plain square of the tint colour
+    Rectangle source_rec = sprites->id != 0 ? sprite_rects[sprite] : (Rectangle){0.0f, 0.0f, 1.0f, 1.0f};
+    float texture_width = sprites->id != 0 ? (float)sprites->width : 1.0f;
+    float texture_height = sprites->id != 0 ? (float)sprites->height : 1.0f;
+
+    float left = source_rec.x / texture_width;
+    float right = (source_rec.x + source_rec.width) / texture_width;
+    float top = source_rec.y / texture_height;
+    float bottom = (source_rec.y + source_rec.height) / texture_height;
+
+    rlTexCoord2f(left, top);
+    rlVertex2f(x, y);
+    rlTexCoord2f(left, bottom);
+    rlVertex2f(x, y + size);
+    rlTexCoord2f(right, bottom);
+    rlVertex2f(x + size, y + size);
+    rlTexCoord2f(right, top);
+    rlVertex2f(x + size, y);
 }
 
-static void draw_score(size_t score)
+// sprites until sprite_batch_end() all go into the board batch, with a single bind of the atlas
+static void sprite_batch_begin(rlRenderBatch *batch, const Texture2D *sprites)
 {
-    const char *text = nob_temp_sprintf("Score: %2lu", score);
-    const size_t font_size = 20;
-    Vector2 text_size = MeasureTextEx(GetFontDefault(), text, font_size, 0);
-    DrawText(text,
-             text_size.x / 2,            //
-             text_size.y / 2, font_size, //
-             YELLOW);
+    // flushes whatever was queued before, so the sprites still draw on top of it
+    rlSetRenderBatchActive(batch);
+
+    rlSetTexture(sprites->id != 0 ? sprites->id : rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
 }
 
-static bool is_opposite_direction(const Vector2 dir1, const Vector2 dir2)
+static void sprite_batch_end(void)
 {
-    return (dir1.x == -dir2.x && dir1.y == dir2.y) || (dir1.x == dir2.x && dir1.y == -dir2.y);
+    rlEnd();
+    rlSetTexture(0);
+
+    rlSetRenderBatchActive(NULL);
 }
 
-static bool is_food_there(const Vector2 position, const Food *food)
+// around the whole board fitted into the size, whatever layout the board is drawn with at the moment
+static void draw_borders(int width, int height)
 {
-    return Vector2Equals(position, food->position);
+    Vector2 offset = calculate_offset_for(width, height, calculate_diameter_for(width, height));
+    DrawRectangle(0, 0, width, offset.y, BLACK);
+    DrawRectangle(0, height - offset.y, width, offset.y, BLACK);
+    DrawRectangle(0, 0, offset.x, height, BLACK);
+    DrawRectangle(width - offset.x, 0, offset.x, height, BLACK);
 }
 
-static bool is_location_inside_snake(const Vector2 location, const Snake *snake)
+static void draw_render_texture(RenderTexture2D target, Color tint)
 {
-    nob_da_foreach(Vector2, segment, &snake->body)
+    // render textures are stored upside down
+    Rectangle source_rec = {0, 0, (float)target.texture.width, (float)-target.texture.height};
+    // while a resize is being debounced the targets are stretched over the new window size
+    Rectangle dest_rec = {0, 0, (float)GetScreenWidth(), (float)GetScreenHeight()};
+    DrawTexturePro(target.texture, source_rec, dest_rec, Vector2Zero(), 0.0f, tint);
+}
+
+#define BACKGROUND_PLACEHOLDER_COLOR DARKGREEN
+
+// everything that only changes with the window size: the scaled background and the borders around the fitted board,
+// the layer matches the window exactly so every frame copies it 1:1 without any filtering. the camera draws the
+// background itself, so the layer never depends on where the camera is
+static void build_background_layer(RenderTexture2D layer, const Texture2D *background)
+{
+    BeginTextureMode(layer);
+
+    // a flat colour until the background is loaded, the layer is built again then
+    ClearBackground(background->id != 0 ? RAYWHITE : BACKGROUND_PLACEHOLDER_COLOR);
+
+    if (background->id != 0)
     {
-        if (Vector2Equals(*segment, location))
-        {
-            return true;
-        }
+        Rectangle source_rec = {0.0f, 0.0f, (float)background->width, (float)background->height};
+        Rectangle dest_rec = {0.0f, 0.0f, (float)layer.texture.width, (float)layer.texture.height};
+        DrawTexturePro(*background, source_rec, dest_rec, Vector2Zero(), 0, WHITE);
     }
 
-    return false;
+    draw_borders(layer.texture.width, layer.texture.height);
+
+    EndTextureMode();
 }
 
-static bool can_spawn_more_food(const Snake *snake)
+#define RESIZE_DEBOUNCE_SECONDS 0.15
+
+typedef struct
 {
-    return snake->body.count != COLUMNS * ROWS;
+    RenderTexture2D scene;
+    RenderTexture2D background_layer;
+    int width;
+    int height;
+    int pending_width;
+    int pending_height;
+    double pending_since;
+    size_t bytes_held;
+} RenderTargets;
+
+static size_t render_texture_bytes(RenderTexture2D target)
+{
+    if (target.id == 0)
+    {
+        return 0;
+    }
+
+    // RGBA8 color attachment plus a (at most) 32 bit depth renderbuffer
+    return (size_t)target.texture.width * target.texture.height * (4 + 4);
 }
 
-static Vector2 random_food_position(const Snake *snake)
+static void render_targets_unload(RenderTargets *targets)
 {
-    Vector2 return_ = {.x = 0, .y = 0};
-
-    do
+    if (targets->scene.id != 0)
     {
-        return_.x = GetRandomValue(0, COLUMNS - 1);
-        return_.y = GetRandomValue(0, ROWS - 1);
-    } while (is_location_inside_snake(return_, snake));
+        UnloadRenderTexture(targets->scene);
+    }
+    if (targets->background_layer.id != 0)
+    {
+        UnloadRenderTexture(targets->background_layer);
+    }
 
-    return return_;
+    targets->scene = (RenderTexture2D){0};
+    targets->background_layer = (RenderTexture2D){0};
+    targets->bytes_held = 0;
 }
 
-static Food food = {0};
+static bool render_targets_resize_pending(const RenderTargets *targets)
+{
+    return targets->pending_width != targets->width || targets->pending_height != targets->height;
+}
 
-static size_t foods_eaten = 0;
+// returns true when the targets were recreated for a new window size
+static bool render_targets_update(RenderTargets *targets, const Texture2D *background)
+{
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    double now = GetTime();
 
-static Snake snake = {0};
+    if (width == targets->width && height == targets->height)
+    {
+        targets->pending_width = width;
+        targets->pending_height = height;
+        return false;
+    }
 
-static Accumulator move_timing = {
-    .ms_accumulated = 0,
-    .ms_to_trigger = 200,
-};
+    if (width != targets->pending_width || height != targets->pending_height)
+    {
+        targets->pending_width = width;
+        targets->pending_height = height;
+        targets->pending_since = now;
+    }
 
-static Accumulator food_animation_timing = {
-    .ms_accumulated = 0,
-    .ms_to_trigger = 500,
-};
+    bool has_targets = targets->scene.id != 0;
+    if (has_targets && now - targets->pending_since < RESIZE_DEBOUNCE_SECONDS)
+    {
+        return false;
+    }
 
-static Vector2 next_direction_input = {0};
+    render_targets_unload(targets);
 
-static void setup(void)
-{
-    snake = (Snake){0};
-    nob_da_append(&snake.body, ((Vector2){10, 2}));
-    nob_da_append(&snake.body, ((Vector2){10, 3}));
-    nob_da_append(&snake.body, ((Vector2){10, 4}));
-    snake.direction = DIRECTION_UP;
+    targets->width = width;
+    targets->height = height;
+    targets->scene = LoadRenderTexture(width, height);
+    targets->background_layer = LoadRenderTexture(width, height);
+    targets->bytes_held = render_texture_bytes(targets->scene) + render_texture_bytes(targets->background_layer);
 
-    food = (Food){
-        .position = (Vector2){1, 3},
-        .color = RED,
-    };
+    build_background_layer(targets->background_layer, background);
 
-    accumulator_reset(&move_timing);
-    next_direction_input = Vector2Zero();
+    TraceLog(LOG_INFO, "Render targets resized to %dx%d, %zu KiB of GPU memory held", width, height,
+             targets->bytes_held / 1024);
+
+    return true;
 }
 
-typedef enum
-{
-    Idle,
-    Playing,
-    Lost
-} State;
+#define HUD_FONT_SIZE 20
 
-static State state = Idle;
+#define HUD_TEXT_CAPACITY 64
 
-int main(void)
+// text that only changes now and then, measured and rendered into its own texture once per change
+typedef struct
 {
-    InitWindow(800, 600, "Snake Game in Raylib");
-
-    SetTargetFPS(60);
-
-    setup();
+    bool valid;
+    char text[HUD_TEXT_CAPACITY];
+    Color color;
+    Vector2 size;
+    RenderTexture2D texture;
+} HudText;
 
-    float lastHeight = 0;
-    float lastWidth = 0;
+// must be called outside of texture mode, as it renders into its own texture
+static void hud_text_update(HudText *hud, const char *text, Color color)
+{
+    if (hud->valid && strcmp(hud->text, text) == 0 && ColorIsEqual(hud->color, color))
+    {
+        return;
+    }
 
-    RenderTexture2D target;
+    hud->valid = true;
+    hud->color = color;
 
-    Texture2D background = LoadTexture(RESOURCES_DIR "bg.jpg");
+    snprintf(hud->text, sizeof(hud->text), "%s", text);
+    // same spacing DrawText uses for the default font
+    hud->size = MeasureTextEx(GetFontDefault(), hud->text, HUD_FONT_SIZE, HUD_FONT_SIZE / 10);
 
-    Texture2D apple_texture = LoadTexture(RESOURCES_DIR "apple.png");
+    if (hud->texture.id != 0)
+    {
+        UnloadRenderTexture(hud->texture);
+    }
+    hud->texture = LoadRenderTexture((int)ceilf(hud->size.x), (int)ceilf(hud->size.y));
 
-    Texture2D snake_atlas = LoadTexture(RESOURCES_DIR "snake-graphics.png");
+    BeginTextureMode(hud->texture);
+    ClearBackground(BLANK);
+    DrawText(hud->text, 0, 0, HUD_FONT_SIZE, color);
+    EndTextureMode();
+}
 
-    while (!WindowShouldClose())
+static void hud_text_unload(HudText *hud)
+{
+    if (hud->texture.id != 0)
     {
-        float height = GetScreenHeight();
-        float width = GetScreenWidth();
+        UnloadRenderTexture(hud->texture);
+    }
+    hud->texture = (RenderTexture2D){0};
+    hud->valid = false;
+}
 
-        if (fabsf(height - lastHeight) > 0.001 || fabsf(width - lastWidth))
-        {
-            lastHeight = height;
-            lastWidth = width;
-            target = LoadRenderTexture(width, height);
-        }
+static void draw_hud_text(const HudText *hud, Vector2 position)
+{
+    Rectangle source_rec = {0, 0, (float)hud->texture.texture.width, (float)-hud->texture.texture.height};
+    DrawTextureRec(hud->texture.texture, source_rec, (Vector2){floorf(position.x), floorf(position.y)}, WHITE);
+}
 
-        if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D))
-        {
-            next_direction_input = DIRECTION_RIGHT;
-        }
-        else if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A))
-        {
-            next_direction_input = DIRECTION_LEFT;
-        }
-        else if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W))
-        {
-            next_direction_input = DIRECTION_UP;
-        }
-        else if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S))
-        {
-            next_direction_input = DIRECTION_DOWN;
-        }
+// half its own size away from the top left corner, where the score goes
+static void draw_corner_hud_text(const HudText *hud)
+{
+    draw_hud_text(hud, Vector2Scale(hud->size, 0.5f));
+}
 
-        if (state == Idle || state == Lost)
-        {
-            if ((next_direction_input.x != 0 || next_direction_input.y != 0) &&
-                (!is_opposite_direction(next_direction_input, snake.direction)))
-            {
-                snake.direction = next_direction_input;
-                foods_eaten = 0;
-                state = Playing;
-            }
-        }
+static void draw_centered_hud_text(const HudText *hud)
+{
+    draw_hud_text(hud, (Vector2){
+                           GetScreenWidth() / 2 - hud->size.x / 2,
+                           GetScreenHeight() / 2 - hud->size.y / 2,
+                       });
+}
 
-        else if (state == Playing)
-        {
-            if (accumulator_tick(&move_timing, GetFrameTime()))
-            {
-                if ((next_direction_input.x != 0 || next_direction_input.y != 0) &&
-                    (!is_opposite_direction(next_direction_input, snake.direction)))
-                {
-                    snake.direction = next_direction_input;
-                }
+static bool is_opposite_direction(const Vector2 dir1, const Vector2 dir2)
+{
+    return dir1.x == -dir2.x && dir1.y == -dir2.y;
+}
 
-                move_timing.ms_to_trigger = max(200 - (5 * ((int)snake.body.count - 2)), 100);
+#define INPUT_QUEUE_CAPACITY 16
+#define INPUT_POLL_INTERVAL_SECONDS 0.001
 
-                Vector2 next_head_position = snake.body.items[0];
-                next_head_position = Vector2Add(next_head_position, snake.direction);
+typedef struct
+{
+    Vector2 direction;
+    uint64_t pressed_at_ns;
+} DirectionInput;
 
-                size_t until = snake.body.count - 1;
+// every press is kept in order, so several turns within a single tick are applied one per tick instead of
+// overwriting each other.
+// single producer (the render thread, which owns the window and polls raylib) and single consumer (the
+// simulation thread), the counters only ever grow and are taken modulo the capacity
+typedef struct
+{
+    DirectionInput items[INPUT_QUEUE_CAPACITY];
+    _Atomic size_t written;
+    // what the consumer is done with, the producer may reuse those slots
+    _Atomic size_t committed;
+    // consumer only, runs ahead of committed until input_queue_commit()
+    size_t read;
+    // lets the consumer sleep until something is pushed
+    pthread_mutex_t lock;
+    pthread_cond_t pushed;
+    // producer only
+    bool debug_overlay_toggled;
+    bool camera_toggled;
+    bool occupancy_toggled;
+    bool minimap_toggled;
+    int zoom_steps;
+    // consumer only, from the press being sampled to the tick that applied it
+    uint64_t ns_last_latency;
+    uint64_t ns_max_latency;
+} InputQueue;
+
+static void input_queue_push(InputQueue *queue, Vector2 direction, uint64_t pressed_at_ns)
+{
+    size_t written = atomic_load_explicit(&queue->written, memory_order_relaxed);
+    if (written - atomic_load_explicit(&queue->committed, memory_order_acquire) == INPUT_QUEUE_CAPACITY)
+    {
+        return;
+    }
 
-                if (is_food_there(next_head_position, &food))
-                {
-                    nob_da_append(&snake.body, snake.body.items[until]);
+    queue->items[written % INPUT_QUEUE_CAPACITY] = (DirectionInput){
+        .direction = direction,
+        .pressed_at_ns = pressed_at_ns,
+    };
+    atomic_store_explicit(&queue->written, written + 1, memory_order_release);
 
-                    foods_eaten++;
+    pthread_mutex_lock(&queue->lock);
+    pthread_cond_signal(&queue->pushed);
+    pthread_mutex_unlock(&queue->lock);
+}
 
-                    if (can_spawn_more_food(&snake))
-                    {
-                        food.position = random_food_position(&snake);
-                    }
-                    else
-                    {
-                        // Not lost, but yeah, I just dont want it crashing
-                        state = Lost;
-                        setup();
-                        goto draw;
-                    }
-                }
+// producer side: true once the consumer committed everything that was pushed
+static bool input_queue_drained(InputQueue *queue)
+{
+    return atomic_load_explicit(&queue->committed, memory_order_acquire) ==
+           atomic_load_explicit(&queue->written, memory_order_relaxed);
+}
 
-                for (size_t i = until; i > 0; i--)
-                {
-                    snake.body.items[i] = snake.body.items[i - 1];
-                }
+static bool input_queue_pop(InputQueue *queue, DirectionInput *input)
+{
+    if (queue->read == atomic_load_explicit(&queue->written, memory_order_acquire))
+    {
+        return false;
+    }
 
-                snake.body.items[0] = next_head_position;
+    *input = queue->items[queue->read % INPUT_QUEUE_CAPACITY];
+    queue->read++;
+    return true;
+}
 
-                nob_da_foreach(Vector2, part, &snake.body)
-                {
-                    if (part != &snake.body.items[0])
-                    {
-                        if (Vector2Equals(*part, snake.body.items[0]))
-                        {
-                            state = Lost;
-                            setup();
-                            goto draw;
-                        }
-                    }
-                }
+// consumer side, hands the popped slots back to the producer
+static void input_queue_commit(InputQueue *queue)
+{
+    atomic_store_explicit(&queue->committed, queue->read, memory_order_release);
+}
 
-                if (next_head_position.x >= COLUMNS || next_head_position.x < 0 || next_head_position.y >= ROWS ||
-                    next_head_position.y < 0)
-                {
-                    state = Lost;
-                    setup();
-                    goto draw;
-                }
-            }
-        }
+static void input_queue_clear(InputQueue *queue)
+{
+    queue->read = atomic_load_explicit(&queue->written, memory_order_acquire);
+}
 
-    draw:
-        BeginDrawing();
+// consumer side, blocks until there is something to pop or quit is set
+static void input_queue_wait(InputQueue *queue, atomic_bool *quit)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->read == atomic_load_explicit(&queue->written, memory_order_acquire) && !atomic_load(quit))
+    {
+        pthread_cond_wait(&queue->pushed, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+}
 
-        if (state == Idle || state == Lost)
+static void input_queue_wake(InputQueue *queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    pthread_cond_broadcast(&queue->pushed);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// pops presses until one is a valid turn from the current direction, the invalid ones are thrown away
+static bool input_queue_pop_turn(InputQueue *queue, Vector2 current_direction, bool allow_straight,
+                                 DirectionInput *turn)
+{
+    DirectionInput input;
+    while (input_queue_pop(queue, &input))
+    {
+        if (is_opposite_direction(input.direction, current_direction))
         {
-            BeginTextureMode(target);
+            continue;
+        }
+        if (!allow_straight && Vector2Equals(input.direction, current_direction))
+        {
+            continue;
         }
 
-        ClearBackground(RAYWHITE);
+        uint64_t latency = nob_nanos_since_unspecified_epoch() - input.pressed_at_ns;
+        queue->ns_last_latency = latency;
+        queue->ns_max_latency = max(queue->ns_max_latency, latency);
 
-        Rectangle source_rec = {0.0f, 0.0f, (float)background.width, (float)background.height};
-        Rectangle dest_rec = {0.0f, 0.0f, width, height};
+        *turn = input;
+        return true;
+    }
 
-        DrawTexturePro(background, source_rec, dest_rec, Vector2Zero(), 0, WHITE);
+    return false;
+}
+
+// drains the keys raylib collected during the last PollInputEvents()
+static void poll_input(InputQueue *queue)
+{
+    uint64_t now_ns = nob_nanos_since_unspecified_epoch();
+
+    for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed())
+    {
+        switch (key)
+        {
+        case KEY_RIGHT:
+        case KEY_D:
+            input_queue_push(queue, DIRECTION_RIGHT, now_ns);
+            break;
+        case KEY_LEFT:
+        case KEY_A:
+            input_queue_push(queue, DIRECTION_LEFT, now_ns);
+            break;
+        case KEY_UP:
+        case KEY_W:
+            input_queue_push(queue, DIRECTION_UP, now_ns);
+            break;
+        case KEY_DOWN:
+        case KEY_S:
+            input_queue_push(queue, DIRECTION_DOWN, now_ns);
+            break;
+        case KEY_F3:
+            queue->debug_overlay_toggled = !queue->debug_overlay_toggled;
+            break;
+        case KEY_C:
+            queue->camera_toggled = !queue->camera_toggled;
+            break;
+        case KEY_F4:
+            queue->occupancy_toggled = !queue->occupancy_toggled;
+            break;
+        case KEY_M:
+            queue->minimap_toggled = !queue->minimap_toggled;
+            break;
+        case KEY_EQUAL:
+        case KEY_KP_ADD:
+            queue->zoom_steps++;
+            break;
+        case KEY_MINUS:
+        case KEY_KP_SUBTRACT:
+            queue->zoom_steps--;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+#define LATENCY_BUCKETS 32
+#define LATENCY_BUCKET_NS (2 * NS_PER_MS)
+
+typedef struct
+{
+    uint64_t pressed_at_ns;
+    uint64_t applied_at_ns;
+    // the first snapshot that shows the turn
+    uint64_t sequence;
+} LatencySample;
+
+// input to photon: from a press being sampled, through the tick that turned the head, to the end of the first
+// frame drawn from a snapshot with that tick.
+// pending is filled by the simulation thread and drained by the render thread, the rest is render thread only
+typedef struct
+{
+    LatencySample pending[INPUT_QUEUE_CAPACITY];
+    _Atomic size_t pending_written;
+    _Atomic size_t pending_read;
+    // the last bucket also collects everything slower than it
+    uint32_t histogram[LATENCY_BUCKETS];
+    uint64_t samples;
+    uint64_t ns_max;
+    FILE *log;
+} LatencyStats;
+
+static void latency_open_log(LatencyStats *stats, const char *path)
+{
+    stats->log = fopen(path, "w");
+    if (stats->log == NULL)
+    {
+        TraceLog(LOG_WARNING, "Could not open %s for writing: %s", path, strerror(errno));
+        return;
+    }
+
+    fprintf(stats->log, "pressed_at_ns,applied_at_ns,presented_at_ns,input_to_tick_ms,input_to_photon_ms\n");
+}
+
+static void latency_close_log(LatencyStats *stats)
+{
+    if (stats->log != NULL)
+    {
+        fclose(stats->log);
+        stats->log = NULL;
+    }
+}
+
+static void latency_turn_applied(LatencyStats *stats, uint64_t pressed_at_ns, uint64_t sequence)
+{
+    size_t written = atomic_load_explicit(&stats->pending_written, memory_order_relaxed);
+    if (written - atomic_load_explicit(&stats->pending_read, memory_order_acquire) == INPUT_QUEUE_CAPACITY)
+    {
+        return;
+    }
+
+    stats->pending[written % INPUT_QUEUE_CAPACITY] = (LatencySample){
+        .pressed_at_ns = pressed_at_ns,
+        .applied_at_ns = nob_nanos_since_unspecified_epoch(),
+        .sequence = sequence,
+    };
+    atomic_store_explicit(&stats->pending_written, written + 1, memory_order_release);
+}
+
+static void latency_frame_presented(LatencyStats *stats, uint64_t presented_at_ns, uint64_t shown_sequence)
+{
+    size_t read = atomic_load_explicit(&stats->pending_read, memory_order_relaxed);
+    size_t written = atomic_load_explicit(&stats->pending_written, memory_order_acquire);
+
+    for (; read != written; read++)
+    {
+        const LatencySample *sample = &stats->pending[read % INPUT_QUEUE_CAPACITY];
+        if (sample->sequence > shown_sequence)
+        {
+            break;
+        }
+
+        uint64_t latency = presented_at_ns - sample->pressed_at_ns;
+
+        size_t bucket = min(latency / LATENCY_BUCKET_NS, LATENCY_BUCKETS - 1);
+        stats->histogram[bucket]++;
+        stats->samples++;
+        stats->ns_max = max(stats->ns_max, latency);
+
+        if (stats->log != NULL)
+        {
+            fprintf(stats->log, "%lu,%lu,%lu,%.3f,%.3f\n", sample->pressed_at_ns, sample->applied_at_ns,
+                    presented_at_ns, (double)(sample->applied_at_ns - sample->pressed_at_ns) / NS_PER_MS,
+                    (double)latency / NS_PER_MS);
+        }
+    }
+
+    atomic_store_explicit(&stats->pending_read, read, memory_order_release);
+}
+
+// upper edge of the bucket the percentile falls in
+static uint64_t latency_percentile(const LatencyStats *stats, double percentile)
+{
+    uint64_t wanted = (uint64_t)ceil(stats->samples * percentile);
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += stats->histogram[i];
+        if (seen >= wanted)
+        {
+            return (i + 1) * LATENCY_BUCKET_NS;
+        }
+    }
+
+    return stats->ns_max;
+}
+
+static void draw_latency_histogram(const LatencyStats *stats, Rectangle area)
+{
+    uint32_t highest = 1;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        highest = max(highest, stats->histogram[i]);
+    }
+
+    DrawRectangleRec(area, Fade(BLACK, 0.5f));
+
+    float bar_width = area.width / LATENCY_BUCKETS;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        float bar_height = area.height * stats->histogram[i] / highest;
+        DrawRectangleRec((Rectangle){area.x + i * bar_width, area.y + area.height - bar_height, bar_width - 1,
+                                     bar_height},
+                         LIME);
+    }
+}
+
+static bool is_food_there(const Vector2 position, const Food *food)
+{
+    return Vector2Equals(position, food->position);
+}
+
+static bool is_location_inside_snake(const Vector2 location, const Snake *snake)
+{
+    nob_da_foreach(Vector2, segment, &snake->body)
+    {
+        if (Vector2Equals(*segment, location))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool can_spawn_more_food(const Snake *snake)
+{
+    return snake->body.count != COLUMNS * ROWS;
+}
+
+static Vector2 random_food_position(const Snake *snake)
+{
+    Vector2 return_ = {.x = 0, .y = 0};
+
+    do
+    {
+        return_.x = GetRandomValue(0, COLUMNS - 1);
+        return_.y = GetRandomValue(0, ROWS - 1);
+    } while (is_location_inside_snake(return_, snake));
+
+    return return_;
+}
+
+static Food food = {0};
+
+static size_t foods_eaten = 0;
+
+static Snake snake = {0};
+
+// the overview of the board: one pixel per MINIMAP_CELLS x MINIMAP_CELLS cells, counting the segments in them
+#define MINIMAP_CELLS 4
+#define MINIMAP_COLUMNS ((COLUMNS + MINIMAP_CELLS - 1) / MINIMAP_CELLS)
+#define MINIMAP_ROWS ((ROWS + MINIMAP_CELLS - 1) / MINIMAP_CELLS)
+
+typedef uint8_t MinimapCounts[MINIMAP_ROWS][MINIMAP_COLUMNS];
+
+// kept up to date by the head entering and the tail leaving a cell, never counted again from the whole body
+static MinimapCounts minimap_counts = {0};
+
+// two pixels per tick at most, for the max_catch_up ticks a step of the simulation runs
+#define MINIMAP_CHANGES_CAPACITY 16
+
+// the pixels whose count changed since the last snapshot, with their new count
+typedef struct
+{
+    struct
+    {
+        uint32_t pixel;
+        uint8_t count;
+    } items[MINIMAP_CHANGES_CAPACITY];
+    uint32_t count;
+    // a new game or more changes than fit, the whole minimap has to be counted again
+    bool all;
+} MinimapChanges;
+
+static MinimapChanges minimap_changes = {.all = true};
+
+static void minimap_count(Vector2 cell, int delta)
+{
+    int row = (int)cell.y / MINIMAP_CELLS;
+    int column = (int)cell.x / MINIMAP_CELLS;
+    minimap_counts[row][column] += delta;
+
+    if (minimap_changes.count == MINIMAP_CHANGES_CAPACITY)
+    {
+        minimap_changes.all = true;
+        return;
+    }
+    minimap_changes.items[minimap_changes.count++].pixel = row * MINIMAP_COLUMNS + column;
+}
+
+static Accumulator move_timing = {
+    .ns_to_trigger = 200 * NS_PER_MS,
+    .max_catch_up = 5,
+};
+
+// a looping animation, falling behind just skips whole periods
+static Accumulator food_animation_timing = {
+    .ns_to_trigger = 500 * NS_PER_MS,
+    .max_catch_up = 1,
+};
+
+static InputQueue input_queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .pushed = PTHREAD_COND_INITIALIZER,
+};
+
+static LatencyStats latency_stats = {0};
+
+static void setup(void)
+{
+    // only the first game allocates, every later one (and every tick growing the snake) reuses the same storage
+    nob_da_reserve(&snake.body, BODY_CAPACITY);
+    nob_da_reserve(&snake.previous_body, BODY_CAPACITY);
+
+    snake.body.count = 0;
+    nob_da_append(&snake.body, ((Vector2){10, 2}));
+    nob_da_append(&snake.body, ((Vector2){10, 3}));
+    nob_da_append(&snake.body, ((Vector2){10, 4}));
+    snake.direction = DIRECTION_UP;
+    snake.previous_body.count = 0;
+    nob_da_append_many(&snake.previous_body, snake.body.items, snake.body.count);
+
+    memset(minimap_counts, 0, sizeof(minimap_counts));
+    nob_da_foreach(Vector2, segment, &snake.body)
+    {
+        minimap_count(*segment, 1);
+    }
+    minimap_changes.all = true;
+
+    food = (Food){
+        .position = (Vector2){1, 3},
+        .color = RED,
+    };
+
+    accumulator_reset(&move_timing);
+    input_queue_clear(&input_queue);
+}
+
+typedef enum
+{
+    Idle,
+    Playing,
+    Lost
+} State;
+
+static State state = Idle;
+
+#define TARGET_FPS 60
+
+// sleeps until the next frame is due, sampling input in short steps in the meantime so presses are picked up
+// (and timestamped) well before the next frame would poll them
+static void wait_for_next_frame(InputQueue *queue, uint64_t frame_start_ns)
+{
+    uint64_t next_frame_ns = frame_start_ns + NS_PER_SECOND / TARGET_FPS;
+
+    for (uint64_t now_ns = nob_nanos_since_unspecified_epoch(); now_ns < next_frame_ns;
+         now_ns = nob_nanos_since_unspecified_epoch())
+    {
+        double remaining = (double)(next_frame_ns - now_ns) / NS_PER_SECOND;
+        WaitTime(min(remaining, INPUT_POLL_INTERVAL_SECONDS));
+        PollInputEvents();
+        poll_input(queue);
+    }
+}
+
+typedef struct
+{
+    uint64_t tick;
+    Vector2 direction;
+} ReplayTurn;
+
+typedef struct
+{
+    ReplayTurn *items;
+    size_t count;
+    size_t capacity;
+} ReplayTurns;
+
+// a whole game from start to loss: with the same seed and the same turns on the same ticks it plays out the same
+typedef struct
+{
+    unsigned int seed;
+    Vector2 start_direction;
+    ReplayTurns turns;
+    uint64_t end_tick;
+} Replay;
+
+// where finished games are written to, NULL when not recording
+static const char *record_dir = NULL;
+
+static Replay recording = {0};
+
+static char direction_to_char(Vector2 direction)
+{
+    if (Vector2Equals(direction, DIRECTION_UP))
+    {
+        return 'U';
+    }
+    if (Vector2Equals(direction, DIRECTION_DOWN))
+    {
+        return 'D';
+    }
+    if (Vector2Equals(direction, DIRECTION_LEFT))
+    {
+        return 'L';
+    }
+    return 'R';
+}
+
+static bool char_to_direction(char c, Vector2 *direction)
+{
+    switch (c)
+    {
+    case 'U':
+        *direction = DIRECTION_UP;
+        return true;
+    case 'D':
+        *direction = DIRECTION_DOWN;
+        return true;
+    case 'L':
+        *direction = DIRECTION_LEFT;
+        return true;
+    case 'R':
+        *direction = DIRECTION_RIGHT;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool replay_save(const Replay *replay, const char *path)
+{
+    Nob_String_Builder sb = {0};
+    nob_sb_appendf(&sb, "seed %u\n", replay->seed);
+    nob_sb_appendf(&sb, "start %c\n", direction_to_char(replay->start_direction));
+    nob_da_foreach(ReplayTurn, turn, &replay->turns)
+    {
+        nob_sb_appendf(&sb, "turn %lu %c\n", turn->tick, direction_to_char(turn->direction));
+    }
+    nob_sb_appendf(&sb, "end %lu\n", replay->end_tick);
+
+    bool result = nob_write_entire_file(path, sb.items, sb.count);
+    nob_sb_free(sb);
+    return result;
+}
+
+static bool replay_load(const char *path, Replay *replay)
+{
+    Nob_String_Builder sb = {0};
+    if (!nob_read_entire_file(path, &sb))
+    {
+        return false;
+    }
+
+    bool result = true;
+    *replay = (Replay){0};
+
+    Nob_String_View content = nob_sb_to_sv(sb);
+    for (size_t line_number = 1; content.count > 0; line_number++)
+    {
+        Nob_String_View line = nob_sv_trim(nob_sv_chop_by_delim(&content, '\n'));
+        if (line.count == 0)
+        {
+            continue;
+        }
+
+        const char *cstr = nob_temp_sv_to_cstr(line);
+        unsigned long tick = 0;
+        char direction = 0;
+        ReplayTurn turn = {0};
+
+        if (sscanf(cstr, "seed %u", &replay->seed) == 1)
+        {
+            continue;
+        }
+        if (sscanf(cstr, "start %c", &direction) == 1 && char_to_direction(direction, &replay->start_direction))
+        {
+            continue;
+        }
+        if (sscanf(cstr, "turn %lu %c", &tick, &direction) == 2 && char_to_direction(direction, &turn.direction))
+        {
+            turn.tick = tick;
+            nob_da_append(&replay->turns, turn);
+            continue;
+        }
+        if (sscanf(cstr, "end %lu", &tick) == 1)
+        {
+            replay->end_tick = tick;
+            continue;
+        }
+
+        TraceLog(LOG_WARNING, "%s:%zu: invalid replay line", path, line_number);
+        result = false;
+        break;
+    }
+
+    nob_sb_free(sb);
+    return result;
+}
+
+static void recording_start(unsigned int seed, Vector2 direction)
+{
+    recording.seed = seed;
+    recording.start_direction = direction;
+    recording.turns.count = 0;
+    recording.end_tick = 0;
+}
+
+static void recording_finish(uint64_t end_tick)
+{
+    if (record_dir == NULL)
+    {
+        return;
+    }
+
+    recording.end_tick = end_tick;
+
+    // runs on the simulation thread, so no nob_temp_* here
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%lu.replay", record_dir, nob_nanos_since_unspecified_epoch());
+    if (replay_save(&recording, path))
+    {
+        TraceLog(LOG_INFO, "Recorded %lu ticks to %s", end_tick, path);
+    }
+}
+
+// reseeded on every start so a recording only depends on its own seed
+static void start_game(Vector2 direction, unsigned int seed)
+{
+    SetRandomSeed(seed);
+    recording_start(seed, direction);
+
+    snake.direction = direction;
+    foods_eaten = 0;
+    state = Playing;
+}
+
+static void lose(void)
+{
+    recording_finish(move_timing.ticks);
+
+    state = Lost;
+    setup();
+}
+
+// returns true when a queued turn was applied this tick
+static bool game_tick(DirectionInput *turn)
+{
+    bool turned = input_queue_pop_turn(&input_queue, snake.direction, false, turn);
+    if (turned)
+    {
+        snake.direction = turn->direction;
+        if (record_dir != NULL)
+        {
+            nob_da_append(&recording.turns, ((ReplayTurn){.tick = move_timing.ticks, .direction = turn->direction}));
+        }
+    }
+
+    move_timing.ns_to_trigger = (uint64_t)(max(200 - (5 * ((int)snake.body.count - 2)), 100)) * NS_PER_MS;
+
+    Vector2 next_head_position = snake.body.items[0];
+    next_head_position = Vector2Add(next_head_position, snake.direction);
+
+    bool grows = is_food_there(next_head_position, &food);
+
+    // the older of the two buffers is overwritten with the moved body, the current one becomes the previous body
+    Body next_body = snake.previous_body;
+    next_body.count = grows ? snake.body.count + 1 : snake.body.count;
+    nob_da_reserve(&next_body, next_body.count);
+    next_body.items[0] = next_head_position;
+    memcpy(&next_body.items[1], snake.body.items, (next_body.count - 1) * sizeof(*next_body.items));
+
+    snake.previous_body = snake.body;
+    snake.body = next_body;
+
+    if (grows)
+    {
+        foods_eaten++;
+
+        if (can_spawn_more_food(&snake))
+        {
+            food.position = random_food_position(&snake);
+        }
+        else
+        {
+            // Not lost, but yeah, I just dont want it crashing
+            lose();
+            return false;
+        }
+    }
+
+    nob_da_foreach(Vector2, part, &snake.body)
+    {
+        if (part != &snake.body.items[0])
+        {
+            if (Vector2Equals(*part, snake.body.items[0]))
+            {
+                lose();
+                return false;
+            }
+        }
+    }
+
+    if (next_head_position.x >= COLUMNS || next_head_position.x < 0 || next_head_position.y >= ROWS ||
+        next_head_position.y < 0)
+    {
+        lose();
+        return false;
+    }
+
+    minimap_count(next_head_position, 1);
+    if (!grows)
+    {
+        minimap_count(snake.previous_body.items[snake.previous_body.count - 1], -1);
+    }
+
+    return turned;
+}
+
+typedef enum
+{
+    // a sprite of the atlas, one cell big
+    DRAW_SPRITE,
+    // text half its size away from the top left corner
+    DRAW_TEXT_CORNER,
+    // text in the middle of the screen
+    DRAW_TEXT_CENTERED,
+    // greys out everything drawn so far
+    DRAW_DIM,
+} DrawCommandKind;
+
+// the food grows and shrinks with the frame's food size instead of being one cell big
+#define DRAW_PULSE (1 << 0)
+// a sprite that stays in its cell for the whole tick, so a backend may keep it from one frame to the next
+#define DRAW_STATIC (1 << 1)
+
+typedef enum
+{
+    TEXT_SLOT_SCORE,
+    TEXT_SLOT_MESSAGE,
+    TEXT_SLOT_COUNT,
+} TextSlot;
+
+typedef struct
+{
+    uint8_t kind;
+    uint8_t flags;
+    // DRAW_SPRITE
+    uint8_t sprite;
+    // texts, so a backend can keep whatever it prepared for a slot until its text changes
+    uint8_t text_slot;
+    Color tint;
+    // what a backend draws for a sprite while the atlas is still loading
+    Color placeholder;
+    // in cells, a sprite moves from one to the other over the course of a tick
+    Vector2 from;
+    Vector2 to;
+    // into the list's text, zero terminated
+    uint32_t text_offset;
+} DrawCommand;
+
+// a snake covering the whole board, the food, the dim and a command per text
+#define DRAW_LIST_CAPACITY (BODY_CAPACITY + 2 + TEXT_SLOT_COUNT)
+
+// everything a frame shows apart from the background, independent of the window size and of the time within a tick:
+// built once per simulation step and drawn by any number of frames, on any backend
+typedef struct
+{
+    DrawCommand *items;
+    size_t count;
+    size_t capacity;
+    // the frame arena for the text runs, emptied but not freed for every new list
+    Nob_String_Builder text;
+    // of the snapshot the list was built from
+    uint64_t sequence;
+    // the DRAW_STATIC sprites come first: they are the commands before static_end, and there are none after it
+    uint32_t static_end;
+    // the text of every slot and the dim as their index + 1, 0 for none, so a backend drawing the static sprites some
+    // other way finds them without going through the snake
+    uint32_t texts[TEXT_SLOT_COUNT];
+    uint32_t dim;
+    // the DRAW_STATIC sprite in every cell as its index + 1, 0 for none, so a backend showing only part of the board
+    // can visit just the cells it shows. ROWS rows on the heap, see snapshot_reserve()
+    uint32_t (*static_cells)[COLUMNS];
+} DrawList;
+
+// everything the render thread needs from one simulation step, copied out so the simulation can keep going
+typedef struct
+{
+    uint64_t sequence;
+    uint64_t published_at_ns;
+    State state;
+    Snake snake;
+    Food food;
+    size_t foods_eaten;
+    Accumulator move_timing;
+    uint64_t input_ns_last_latency;
+    uint64_t input_ns_max_latency;
+    MinimapChanges minimap_changes;
+    // built from the rest on the simulation thread
+    DrawList draw_list;
+} Snapshot;
+
+#define SNAPSHOT_INDEX_MASK 3u
+#define SNAPSHOT_FRESH 4u
+
+// lock free triple buffer: the simulation always has a back snapshot to write, the render thread always has a
+// front snapshot to read, and they trade through the middle one
+typedef struct
+{
+    Snapshot slots[3];
+    // index of the middle slot, SNAPSHOT_FRESH while it holds a snapshot the reader has not taken yet
+    _Atomic uint32_t middle;
+    // simulation thread only
+    uint32_t back;
+    // render thread only
+    uint32_t front;
+} SnapshotBuffer;
+
+typedef struct
+{
+    SnapshotBuffer snapshots;
+    pthread_t thread;
+    atomic_bool quit;
+    // simulation thread only
+    uint64_t published;
+} Simulation;
+
+static Simulation simulation = {
+    .snapshots =
+        {
+            .front = 0,
+            .middle = 1,
+            .back = 2,
+        },
+};
+
+static void body_copy(Body *destination, const Body *source)
+{
+    destination->count = 0;
+    nob_da_append_many(destination, source->items, source->count);
+}
+
+static void draw_list_push_sprite(DrawList *list, SpriteId sprite, Vector2 from, Vector2 to, Color tint,
+                                  Color placeholder, uint8_t flags)
+{
+    nob_da_append(list, ((DrawCommand){
+                            .kind = DRAW_SPRITE,
+                            .flags = flags,
+                            .sprite = sprite,
+                            .tint = tint,
+                            .placeholder = placeholder,
+                            .from = from,
+                            .to = to,
+                        }));
+
+    if (flags & DRAW_STATIC)
+    {
+        list->static_cells[(int)to.y][(int)to.x] = (uint32_t)list->count;
+    }
+}
+
+static void draw_list_push_text(DrawList *list, DrawCommandKind kind, TextSlot slot, Color tint, const char *format,
+                                size_t value)
+{
+    uint32_t offset = (uint32_t)list->text.count;
+    nob_sb_appendf(&list->text, format, value);
+    nob_sb_append_null(&list->text);
+
+    list->texts[slot] = (uint32_t)list->count + 1;
+    nob_da_append(list, ((DrawCommand){.kind = kind, .text_slot = slot, .tint = tint, .text_offset = offset}));
+}
+
+static void draw_list_push_dim(DrawList *list)
+{
+    list->dim = (uint32_t)list->count + 1;
+    nob_da_append(list, ((DrawCommand){.kind = DRAW_DIM}));
+}
+
+static const char *draw_list_text(const DrawList *list, const DrawCommand *command)
+{
+    return &list->text.items[command->text_offset];
+}
+
+// the scene of a snapshot as draw commands, in drawing order
+static void draw_list_push_segment(DrawList *list, const Snake *snake, size_t i, uint8_t flags)
+{
+    const Vector2 *segment = &snake->body.items[i];
+    // a segment that was just grown has no previous position and stays put
+    Vector2 from = i < snake->previous_body.count && !(flags & DRAW_STATIC) ? snake->previous_body.items[i] : *segment;
+    draw_list_push_sprite(list, sprite_for_snake_body_part(snake, segment), from, *segment, ORANGE, ORANGE, flags);
+}
+
+static void draw_list_build(DrawList *list, const Snapshot *snapshot)
+{
+    // only the cells the last list used are cleared, so keeping the index costs as much as the snake and not the board
+    for (size_t i = 0; i < list->static_end; i++)
+    {
+        list->static_cells[(int)list->items[i].to.y][(int)list->items[i].to.x] = 0;
+    }
+
+    list->count = 0;
+    list->text.count = 0;
+    list->sequence = snapshot->sequence;
+    memset(list->texts, 0, sizeof(list->texts));
+    list->dim = 0;
+
+    const Snake *snake = &snapshot->snake;
+    size_t count = snake->body.count;
+    for (size_t i = 1; i + 1 < count; i++)
+    {
+        draw_list_push_segment(list, snake, i, DRAW_STATIC);
+    }
+    list->static_end = (uint32_t)list->count;
+    // only the ends move, the segment in front of the tail slides over its own cell as well so the tail never leaves
+    // a gap behind
+    if (count >= 3)
+    {
+        draw_list_push_segment(list, snake, count - 2, 0);
+    }
+    if (count >= 2)
+    {
+        draw_list_push_segment(list, snake, count - 1, 0);
+    }
+    if (count >= 1)
+    {
+        draw_list_push_segment(list, snake, 0, 0);
+    }
+
+    const Food *food = &snapshot->food;
+    draw_list_push_sprite(list, SPRITE_APPLE, food->position, food->position, WHITE, food->color, DRAW_PULSE);
+
+    draw_list_push_text(list, DRAW_TEXT_CORNER, TEXT_SLOT_SCORE, YELLOW, "Score: %2lu", snapshot->foods_eaten);
+
+    if (snapshot->state == Idle)
+    {
+        draw_list_push_dim(list);
+        draw_list_push_text(list, DRAW_TEXT_CENTERED, TEXT_SLOT_MESSAGE, YELLOW,
+                            "Use arrow keys (or WASD) to move the snake", 0);
+    }
+    else if (snapshot->state == Lost)
+    {
+        draw_list_push_dim(list);
+        draw_list_push_text(list, DRAW_TEXT_CENTERED, TEXT_SLOT_MESSAGE, YELLOW,
+                            "Lost! Score: %2lu\nMove again to restart.", snapshot->foods_eaten);
+    }
+}
+
+// the null backend: walks the list like a real one would, without drawing anything, for profiling what the list costs
+static uint64_t null_draw(const DrawList *list, int snake_step, int food_size)
+{
+    uint64_t checksum = 0;
+
+    nob_da_foreach(DrawCommand, command, list)
+    {
+        int size = command->flags & DRAW_PULSE ? food_size : 1;
+        checksum += (uint64_t)(command->from.x + command->to.y) * (uint64_t)snake_step + (uint64_t)size +
+                    command->kind + command->sprite;
+    }
+
+    return checksum;
+}
+
+// everything a snapshot can ever hold allocated up front, so capturing one never allocates. the cell index is as big
+// as the board, so it never lives on the stack with the snapshot
+static void snapshot_reserve(Snapshot *snapshot)
+{
+    nob_da_reserve(&snapshot->snake.body, BODY_CAPACITY);
+    nob_da_reserve(&snapshot->snake.previous_body, BODY_CAPACITY);
+    nob_da_reserve(&snapshot->draw_list, DRAW_LIST_CAPACITY);
+    nob_da_reserve(&snapshot->draw_list.text, TEXT_SLOT_COUNT * HUD_TEXT_CAPACITY);
+    snapshot->draw_list.static_cells = calloc(ROWS, sizeof(*snapshot->draw_list.static_cells));
+}
+
+static void snapshot_free(Snapshot *snapshot)
+{
+    nob_da_free(snapshot->snake.body);
+    nob_da_free(snapshot->snake.previous_body);
+    nob_da_free(snapshot->draw_list);
+    nob_sb_free(snapshot->draw_list.text);
+    free(snapshot->draw_list.static_cells);
+}
+
+static void snapshot_capture(Snapshot *snapshot, uint64_t sequence, uint64_t now_ns)
+{
+    snapshot->sequence = sequence;
+    snapshot->published_at_ns = now_ns;
+    snapshot->state = state;
+    snapshot->snake.direction = snake.direction;
+    body_copy(&snapshot->snake.body, &snake.body);
+    body_copy(&snapshot->snake.previous_body, &snake.previous_body);
+    snapshot->food = food;
+    snapshot->foods_eaten = foods_eaten;
+    snapshot->move_timing = move_timing;
+    snapshot->input_ns_last_latency = input_queue.ns_last_latency;
+    snapshot->input_ns_max_latency = input_queue.ns_max_latency;
+    snapshot->minimap_changes = minimap_changes;
+    for (uint32_t i = 0; i < minimap_changes.count; i++)
+    {
+        uint32_t pixel = minimap_changes.items[i].pixel;
+        snapshot->minimap_changes.items[i].count = minimap_counts[pixel / MINIMAP_COLUMNS][pixel % MINIMAP_COLUMNS];
+    }
+    minimap_changes = (MinimapChanges){0};
+
+    draw_list_build(&snapshot->draw_list, snapshot);
+}
+
+static void simulation_publish(Simulation *simulation, uint64_t now_ns)
+{
+    SnapshotBuffer *buffer = &simulation->snapshots;
+    snapshot_capture(&buffer->slots[buffer->back], ++simulation->published, now_ns);
+
+    uint32_t previous =
+        atomic_exchange_explicit(&buffer->middle, buffer->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+    buffer->back = previous & SNAPSHOT_INDEX_MASK;
+}
+
+// render thread side, the most recent snapshot the simulation published
+static const Snapshot *simulation_latest(Simulation *simulation)
+{
+    SnapshotBuffer *buffer = &simulation->snapshots;
+
+    if (atomic_load_explicit(&buffer->middle, memory_order_acquire) & SNAPSHOT_FRESH)
+    {
+        uint32_t previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = previous & SNAPSHOT_INDEX_MASK;
+    }
+
+    return &buffer->slots[buffer->front];
+}
+
+// how far the snake is into the next tick at a given time, a snapshot published after it counts as just published
+static float snapshot_progress(const Snapshot *snapshot, uint64_t now_ns)
+{
+    Accumulator timing = snapshot->move_timing;
+    if (now_ns > snapshot->published_at_ns)
+    {
+        timing.ns_accumulated += now_ns - snapshot->published_at_ns;
+    }
+    return accumulator_progress(timing);
+}
+
+// in cells, progress of the way from where the head was on the last tick
+static Vector2 snapshot_head(const Snapshot *snapshot, float progress)
+{
+    const Snake *snake = &snapshot->snake;
+    if (snake->body.count == 0)
+    {
+        return (Vector2){COLUMNS / 2, ROWS / 2};
+    }
+
+    Vector2 from = snake->previous_body.count > 0 ? snake->previous_body.items[0] : snake->body.items[0];
+    return Vector2Lerp(from, snake->body.items[0], progress);
+}
+
+static void sleep_until(uint64_t deadline_ns)
+{
+    struct timespec deadline = {
+        .tv_sec = deadline_ns / NS_PER_SECOND,
+        .tv_nsec = deadline_ns % NS_PER_SECOND,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
+
+// owns snake, food, state and the move clock, nothing else touches them while the thread runs
+static void *simulation_run(void *argument)
+{
+    Simulation *simulation = argument;
+    uint64_t last_ns = nob_nanos_since_unspecified_epoch();
+
+    while (!atomic_load(&simulation->quit))
+    {
+        uint64_t now_ns = nob_nanos_since_unspecified_epoch();
+        uint64_t dt_ns = now_ns - last_ns;
+        last_ns = now_ns;
+
+        bool changed = false;
+        size_t heap_operations_before = heap_operations_count();
+
+        if (state == Idle || state == Lost)
+        {
+            DirectionInput turn;
+            if (input_queue_pop_turn(&input_queue, snake.direction, true, &turn))
+            {
+                start_game(turn.direction, (unsigned int)now_ns);
+                changed = true;
+            }
+        }
+
+        else if (state == Playing)
+        {
+            accumulator_advance(&move_timing, dt_ns);
+            while (state == Playing && accumulator_tick(&move_timing))
+            {
+                DirectionInput turn;
+                if (game_tick(&turn) && state == Playing)
+                {
+                    latency_turn_applied(&latency_stats, turn.pressed_at_ns, simulation->published + 1);
+                }
+                changed = true;
+            }
+        }
+
+        if (changed)
+        {
+            simulation_publish(simulation, now_ns);
+        }
+        // restarts included, only saving a recording when a game ends may allocate
+        if (record_dir == NULL && heap_operations_count() != heap_operations_before)
+        {
+            TraceLog(LOG_WARNING, "A simulation step made %zu heap operations",
+                     heap_operations_count() - heap_operations_before);
+        }
+        // only after publishing, so once the render thread sees the queue drained the snapshot is there too
+        input_queue_commit(&input_queue);
+
+        if (state == Playing)
+        {
+            sleep_until(now_ns + (move_timing.ns_to_trigger - move_timing.ns_accumulated));
+        }
+        else
+        {
+            input_queue_wait(&input_queue, &simulation->quit);
+        }
+    }
+
+    return NULL;
+}
+
+static void simulation_start(Simulation *simulation)
+{
+    for (size_t i = 0; i < NOB_ARRAY_LEN(simulation->snapshots.slots); i++)
+    {
+        snapshot_reserve(&simulation->snapshots.slots[i]);
+    }
+
+    simulation_publish(simulation, nob_nanos_since_unspecified_epoch());
+    simulation_latest(simulation);
+
+    int error = pthread_create(&simulation->thread, NULL, simulation_run, simulation);
+    if (error != 0)
+    {
+        TraceLog(LOG_FATAL, "Could not start the simulation thread: %s", strerror(error));
+    }
+}
+
+static void simulation_stop(Simulation *simulation)
+{
+    atomic_store(&simulation->quit, true);
+    input_queue_wake(&input_queue);
+    pthread_join(simulation->thread, NULL);
+}
+
+static void draw_debug_overlay(const RenderTargets *targets, const Snapshot *snapshot, const LatencyStats *latency)
+{
+    const char *text = nob_temp_sprintf("FPS: %d\n"
+                                        "Render targets: %dx%d, %zu KiB\n"
+                                        "Tick: %.1fms, late %.2fms (max %.2fms), dropped %.1fms\n"
+                                        "Input to tick: %.2fms (max %.2fms)\n"
+                                        "Input to photon: p50 <%.0fms, p95 <%.0fms, max %.2fms (%lu samples)",
+                                        GetFPS(), targets->width, targets->height, targets->bytes_held / 1024,
+                                        (double)snapshot->move_timing.ns_to_trigger / NS_PER_MS,
+                                        (double)snapshot->move_timing.ns_late / NS_PER_MS,
+                                        (double)snapshot->move_timing.ns_late_max / NS_PER_MS,
+                                        (double)snapshot->move_timing.ns_dropped / NS_PER_MS,
+                                        (double)snapshot->input_ns_last_latency / NS_PER_MS,
+                                        (double)snapshot->input_ns_max_latency / NS_PER_MS,
+                                        (double)latency_percentile(latency, 0.50) / NS_PER_MS,
+                                        (double)latency_percentile(latency, 0.95) / NS_PER_MS,
+                                        (double)latency->ns_max / NS_PER_MS, latency->samples);
+    const size_t font_size = 10;
+    const float text_top = GetScreenHeight() - 6 * font_size - 10;
+    DrawText(text, 10, text_top, font_size, LIME);
+
+    // one bar per LATENCY_BUCKET_NS of input to photon latency
+    draw_latency_histogram(latency, (Rectangle){10, text_top - 50, LATENCY_BUCKETS * 4, 40});
+}
+
+typedef enum
+{
+    ASSET_SPRITES,
+    ASSET_BACKGROUND,
+    ASSET_COUNT,
+} AssetId;
+
+// the images are already decoded into the binary, but creating a texture still costs a copy to the GPU (and the
+// mipmaps of the background): one of them per frame keeps the first frames going, with flat colours until then
+static Image asset_image(AssetId id)
+{
+    switch (id)
+    {
+    case ASSET_SPRITES:
+        return embedded_sprites;
+    case ASSET_BACKGROUND:
+        return embedded_background;
+    case ASSET_COUNT:
+        break;
+    }
+
+    NOB_UNREACHABLE("asset_image");
+}
+
+// the board is cached in square chunks of cells, each holding the background and the DRAW_STATIC sprites: a new tick
+// only redraws the chunks at the two ends of the static run (the old head becoming the neck, the cell released in
+// front of the tail), so the cost follows what changed instead of the length of the snake or the size of the board
+#define CHUNK_CELLS 8
+#define CHUNK_COLUMNS ((COLUMNS + CHUNK_CELLS - 1) / CHUNK_CELLS)
+#define CHUNK_ROWS ((ROWS + CHUNK_CELLS - 1) / CHUNK_CELLS)
+
+typedef struct
+{
+    // CHUNK_ROWS rows of each, on the heap while the chunks are loaded
+    RenderTexture2D (*textures)[CHUNK_COLUMNS];
+    bool (*dirty)[CHUNK_COLUMNS];
+    // the list the chunks were last brought up to date with, only the ends of its static run are kept
+    uint64_t sequence;
+    uint32_t static_count;
+    Vector2 first_static;
+    Vector2 last_static;
+    // the layout the chunks were made for, they are skipped while the layout is another one
+    int width;
+    int height;
+    uint8_t diameter;
+    size_t bytes_held;
+} BoardChunks;
+
+static void board_chunks_unload(BoardChunks *chunks)
+{
+    if (chunks->textures != NULL)
+    {
+        for (int chunk_row = 0; chunk_row < CHUNK_ROWS; chunk_row++)
+        {
+            for (int chunk_column = 0; chunk_column < CHUNK_COLUMNS; chunk_column++)
+            {
+                UnloadRenderTexture(chunks->textures[chunk_row][chunk_column]);
+            }
+        }
+    }
+    free(chunks->textures);
+    free(chunks->dirty);
+
+    *chunks = (BoardChunks){0};
+}
+
+static void board_chunks_load(BoardChunks *chunks, const Layout *layout)
+{
+    board_chunks_unload(chunks);
+
+    chunks->width = layout->width;
+    chunks->height = layout->height;
+    chunks->diameter = layout->diameter;
+    chunks->textures = calloc(CHUNK_ROWS, sizeof(*chunks->textures));
+    chunks->dirty = calloc(CHUNK_ROWS, sizeof(*chunks->dirty));
+
+    for (int chunk_row = 0; chunk_row < CHUNK_ROWS; chunk_row++)
+    {
+        for (int chunk_column = 0; chunk_column < CHUNK_COLUMNS; chunk_column++)
+        {
+            // the last row and column of chunks only cover what is left of the board
+            int columns = min(CHUNK_CELLS, COLUMNS - chunk_column * CHUNK_CELLS);
+            int rows = min(CHUNK_CELLS, ROWS - chunk_row * CHUNK_CELLS);
+
+            RenderTexture2D *texture = &chunks->textures[chunk_row][chunk_column];
+            *texture = LoadRenderTexture(columns * layout->diameter, rows * layout->diameter);
+            chunks->bytes_held += render_texture_bytes(*texture);
+            chunks->dirty[chunk_row][chunk_column] = true;
+        }
+    }
+
+    TraceLog(LOG_INFO, "Board chunks resized to %d px, %zu KiB of GPU memory held", CHUNK_CELLS * layout->diameter,
+             chunks->bytes_held / 1024);
+}
+
+static bool board_chunks_match(const BoardChunks *chunks, const Layout *layout)
+{
+    return chunks->textures != NULL && !layout->camera && chunks->width == layout->width &&
+           chunks->height == layout->height && chunks->diameter == layout->diameter;
+}
+
+static void board_chunks_invalidate(BoardChunks *chunks)
+{
+    if (chunks->dirty != NULL)
+    {
+        memset(chunks->dirty, true, CHUNK_ROWS * sizeof(*chunks->dirty));
+    }
+}
+
+static void board_chunks_mark(BoardChunks *chunks, Vector2 cell)
+{
+    chunks->dirty[(int)cell.y / CHUNK_CELLS][(int)cell.x / CHUNK_CELLS] = true;
+}
+
+// a single tick moves the static run one cell along: the old head becomes its first cell and its last cell is
+// released (or kept, when the snake grew), every other cell keeps its sprite. so for the list right after the cached
+// one, with the cached first cell now second, only the chunks of the two ends are marked. a new game, a snapshot the
+// renderer never saw or several ticks caught up at once mark every chunk instead
+static void board_chunks_take_cells(BoardChunks *chunks, const DrawList *list)
+{
+    uint32_t count = list->static_end;
+    bool one_tick = list->sequence == chunks->sequence + 1 && chunks->static_count > 0 &&
+                    (count == chunks->static_count || count == chunks->static_count + 1) &&
+                    list->static_cells[(int)chunks->first_static.y][(int)chunks->first_static.x] == 2;
+    if (one_tick)
+    {
+        board_chunks_mark(chunks, list->items[0].to);
+        board_chunks_mark(chunks, chunks->last_static);
+    }
+    else
+    {
+        board_chunks_invalidate(chunks);
+    }
+
+    chunks->sequence = list->sequence;
+    chunks->static_count = count;
+    if (count > 0)
+    {
+        chunks->first_static = list->items[0].to;
+        chunks->last_static = list->items[count - 1].to;
+    }
+}
+
+// the sprites come from the list's cell index, it has to be the list last taken
+static void board_chunks_redraw(BoardChunks *chunks, const DrawList *list, const Layout *layout,
+                                RenderTexture2D background_layer, const Texture2D *sprites, rlRenderBatch *batch)
+{
+    for (int chunk_row = 0; chunk_row < CHUNK_ROWS; chunk_row++)
+    {
+        for (int chunk_column = 0; chunk_column < CHUNK_COLUMNS; chunk_column++)
+        {
+            if (!chunks->dirty[chunk_row][chunk_column])
+            {
+                continue;
+            }
+            chunks->dirty[chunk_row][chunk_column] = false;
+
+            RenderTexture2D texture = chunks->textures[chunk_row][chunk_column];
+            int first_column = chunk_column * CHUNK_CELLS;
+            int first_row = chunk_row * CHUNK_CELLS;
+            int end_column = min(first_column + CHUNK_CELLS, COLUMNS);
+            int end_row = min(first_row + CHUNK_CELLS, ROWS);
+            float left = layout->column_x[first_column];
+            float top = layout->row_y[first_row];
+            float width = (float)texture.texture.width;
+            float height = (float)texture.texture.height;
+
+            BeginTextureMode(texture);
+
+            // the background layer is upside down like every render texture, so the chunk's rows are counted from
+            // its bottom
+            Rectangle source_rec = {left, background_layer.texture.height - top - height, width, -height};
+            DrawTexturePro(background_layer.texture, source_rec, (Rectangle){0.0f, 0.0f, width, height},
+                           Vector2Zero(), 0.0f, WHITE);
+
+            sprite_batch_begin(batch, sprites);
+            for (int row = first_row; row < end_row; row++)
+            {
+                for (int column = first_column; column < end_column; column++)
+                {
+                    uint32_t index = list->static_cells[row][column];
+                    if (index == 0)
+                    {
+                        continue;
+                    }
+
+                    const DrawCommand *command = &list->items[index - 1];
+                    Color color = sprites->id != 0 ? command->tint : command->placeholder;
+                    rlColor4ub(color.r, color.g, color.b, color.a);
+                    push_sprite_quad(sprites, command->sprite, layout->column_x[column] - left,
+                                     layout->row_y[row] - top, layout->diameter);
+                }
+            }
+            sprite_batch_end();
+
+            EndTextureMode();
+        }
+    }
+}
+
+static void board_chunks_draw(const BoardChunks *chunks, const Layout *layout)
+{
+    for (int chunk_row = 0; chunk_row < CHUNK_ROWS; chunk_row++)
+    {
+        for (int chunk_column = 0; chunk_column < CHUNK_COLUMNS; chunk_column++)
+        {
+            Texture2D texture = chunks->textures[chunk_row][chunk_column].texture;
+            Rectangle source_rec = {0.0f, 0.0f, (float)texture.width, (float)-texture.height};
+            Vector2 position = {layout->column_x[chunk_column * CHUNK_CELLS], layout->row_y[chunk_row * CHUNK_CELLS]};
+            DrawTextureRec(texture, source_rec, position, WHITE);
+        }
+    }
+}
+
+#define OCCUPANCY_FULL_UPLOAD_TEXELS 64
+
+// the DRAW_STATIC sprites as one texel per cell (the tint, with the sprite index + 1 in alpha), drawn as a single quad
+// over the whole board by a shader looking the sprites up in the atlas: the CPU cost of a frame is the same for any
+// board size, and a tick only uploads the texels that changed
+typedef struct
+{
+    bool enabled;
+    Shader shader;
+    int atlas_location;
+    int sprite_rects_location;
+    Texture2D texture;
+    // what the texture holds, ROWS rows
+    Color (*texels)[COLUMNS];
+    // the cells with a sprite as row * COLUMNS + column, so the ones the snake left are found without going through
+    // the whole board. like the texels, ROWS * COLUMNS of them on the heap, allocated with the shader
+    uint32_t *occupied;
+    size_t occupied_count;
+    uint32_t *changed;
+    size_t changed_count;
+    uint64_t sequence;
+} BoardOccupancy;
+
+// the shared body of the shader, after a header for the GLSL version the context supports
+static const char *occupancy_fragment_body =
+    "VARYING_IN vec2 fragTexCoord;\n"
+    "VARYING_IN vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform sampler2D atlas;\n"
+    "uniform vec4 spriteRects[SPRITE_COUNT];\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 texel = TEXTURE(texture0, fragTexCoord);\n"
+    "    int sprite = int(texel.a * 255.0 + 0.5) - 1;\n"
+    "    if (sprite < 0) discard;\n"
+    // a loop instead of indexing with sprite, GLSL 100 only allows constant indices into uniform arrays
+    "    vec4 rect = vec4(0.0);\n"
+    "    for (int i = 0; i < SPRITE_COUNT; i++)\n"
+    "    {\n"
+    "        if (i == sprite) rect = spriteRects[i];\n"
+    "    }\n"
+    "    vec2 within = fract(fragTexCoord * vec2(BOARD_COLUMNS, BOARD_ROWS));\n"
+    "    FRAG_COLOR = TEXTURE(atlas, rect.xy + within * rect.zw) * vec4(texel.rgb, 1.0) * fragColor;\n"
+    "}\n";
+
+static const char *occupancy_fragment_header(void)
+{
+    switch (rlGetVersion())
+    {
+    case RL_OPENGL_33:
+    case RL_OPENGL_43:
+        return "#version 330\n"
+               "#define VARYING_IN in\n"
+               "#define TEXTURE texture\n"
+               "out vec4 finalColor;\n"
+               "#define FRAG_COLOR finalColor\n";
+    case RL_OPENGL_21:
+        return "#version 120\n"
+               "#define VARYING_IN varying\n"
+               "#define TEXTURE texture2D\n"
+               "#define FRAG_COLOR gl_FragColor\n";
+    case RL_OPENGL_ES_20:
+    case RL_OPENGL_ES_30:
+        return "#version 100\n"
+               "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+               "precision highp float;\n"
+               "#else\n"
+               "precision mediump float;\n"
+               "#endif\n"
+               "#define VARYING_IN varying\n"
+               "#define TEXTURE texture2D\n"
+               "#define FRAG_COLOR gl_FragColor\n";
+    default:
+        return NULL;
+    }
+}
+
+static void board_occupancy_unload(BoardOccupancy *occupancy)
+{
+    // the texture and the cells only exist with a valid shader
+    if (IsShaderValid(occupancy->shader))
+    {
+        UnloadShader(occupancy->shader);
+        UnloadTexture(occupancy->texture);
+        free(occupancy->texels);
+        free(occupancy->occupied);
+        free(occupancy->changed);
+    }
+    *occupancy = (BoardOccupancy){0};
+}
+
+// returns false when the context can't run the shader, the static sprites are drawn some other way then
+static bool board_occupancy_load(BoardOccupancy *occupancy)
+{
+    *occupancy = (BoardOccupancy){0};
+
+    const char *header = occupancy_fragment_header();
+    if (header == NULL)
+    {
+        TraceLog(LOG_WARNING, "Occupancy board: no shaders on this OpenGL version");
+        return false;
+    }
+
+    const char *source =
+        nob_temp_sprintf("%s#define SPRITE_COUNT %d\n#define BOARD_COLUMNS %d.0\n#define BOARD_ROWS %d.0\n%s", header,
+                         SPRITE_COUNT, COLUMNS, ROWS, occupancy_fragment_body);
+    occupancy->shader = LoadShaderFromMemory(NULL, source);
+    if (!IsShaderValid(occupancy->shader))
+    {
+        TraceLog(LOG_WARNING, "Occupancy board: the shader did not compile");
+        return false;
+    }
+    occupancy->atlas_location = GetShaderLocation(occupancy->shader, "atlas");
+    occupancy->sprite_rects_location = GetShaderLocation(occupancy->shader, "spriteRects");
+
+    Image image = GenImageColor(COLUMNS, ROWS, BLANK);
+    occupancy->texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    SetTextureFilter(occupancy->texture, TEXTURE_FILTER_POINT);
+    SetTextureWrap(occupancy->texture, TEXTURE_WRAP_CLAMP);
+
+    occupancy->texels = calloc(ROWS, sizeof(*occupancy->texels));
+    occupancy->occupied = malloc(ROWS * COLUMNS * sizeof(*occupancy->occupied));
+    occupancy->changed = malloc(ROWS * COLUMNS * sizeof(*occupancy->changed));
+
+    return true;
+}
+
+// the rectangles only change with the atlas, in its texture coordinates
+static void board_occupancy_set_atlas(BoardOccupancy *occupancy, const Texture2D *sprites)
+{
+    Vector4 rects[SPRITE_COUNT];
+    for (int sprite = 0; sprite < SPRITE_COUNT; sprite++)
+    {
+        rects[sprite] = (Vector4){
+            sprite_rects[sprite].x / sprites->width,
+            sprite_rects[sprite].y / sprites->height,
+            sprite_rects[sprite].width / sprites->width,
+            sprite_rects[sprite].height / sprites->height,
+        };
+    }
+    SetShaderValueV(occupancy->shader, occupancy->sprite_rects_location, rects, SHADER_UNIFORM_VEC4, SPRITE_COUNT);
+}
+
+static void board_occupancy_set_texel(BoardOccupancy *occupancy, int row, int column, Color texel)
+{
+    if (ColorIsEqual(occupancy->texels[row][column], texel))
+    {
+        return;
+    }
+
+    occupancy->texels[row][column] = texel;
+    occupancy->changed[occupancy->changed_count++] = (uint32_t)(row * COLUMNS + column);
+}
+
+// costs as much as the snake, not the board: the cells it left are found through the cells it was in before
+static void board_occupancy_take_cells(BoardOccupancy *occupancy, const DrawList *list)
+{
+    occupancy->changed_count = 0;
+
+    for (size_t i = 0; i < occupancy->occupied_count; i++)
+    {
+        int row = occupancy->occupied[i] / COLUMNS;
+        int column = occupancy->occupied[i] % COLUMNS;
+        if (list->static_cells[row][column] == 0)
+        {
+            board_occupancy_set_texel(occupancy, row, column, BLANK);
+        }
+    }
+
+    occupancy->occupied_count = 0;
+    for (size_t i = 0; i < list->static_end; i++)
+    {
+        const DrawCommand *command = &list->items[i];
+        int row = (int)command->to.y;
+        int column = (int)command->to.x;
+        Color texel = {command->tint.r, command->tint.g, command->tint.b, command->sprite + 1};
+        board_occupancy_set_texel(occupancy, row, column, texel);
+        occupancy->occupied[occupancy->occupied_count++] = (uint32_t)(row * COLUMNS + column);
+    }
+
+    // a new game changes most of the board, one upload is cheaper than that many small ones then
+    if (occupancy->changed_count > OCCUPANCY_FULL_UPLOAD_TEXELS)
+    {
+        UpdateTexture(occupancy->texture, occupancy->texels);
+    }
+    else
+    {
+        for (size_t i = 0; i < occupancy->changed_count; i++)
+        {
+            int row = occupancy->changed[i] / COLUMNS;
+            int column = occupancy->changed[i] % COLUMNS;
+            UpdateTextureRec(occupancy->texture, (Rectangle){column, row, 1, 1}, &occupancy->texels[row][column]);
+        }
+    }
+
+    occupancy->sequence = list->sequence;
+}
+
+static void board_occupancy_draw(const BoardOccupancy *occupancy, const Layout *layout, const Texture2D *sprites)
+{
+    Rectangle source_rec = {0.0f, 0.0f, COLUMNS, ROWS};
+    Rectangle board_rec = {layout->offset.x, layout->offset.y, COLUMNS * layout->diameter, ROWS * layout->diameter};
+
+    BeginShaderMode(occupancy->shader);
+    SetShaderValueTexture(occupancy->shader, occupancy->atlas_location, *sprites);
+    DrawTexturePro(occupancy->texture, source_rec, board_rec, Vector2Zero(), 0.0f, WHITE);
+    EndShaderMode();
+}
+
+#define MINIMAP_WIDTH 160
+#define MINIMAP_MARGIN 10
+
+// the minimap's counts as a texture, only the pixels a snapshot changed are uploaded again
+typedef struct
+{
+    Texture2D texture;
+    // MINIMAP_ROWS * MINIMAP_COLUMNS, only used when the whole texture is counted again
+    Color *pixels;
+    // the snapshot the texture shows, 0 for none
+    uint64_t sequence;
+} MinimapView;
+
+static Color minimap_pixel(uint8_t count)
+{
+    return (Color){ORANGE.r, ORANGE.g, ORANGE.b, count * 255 / (MINIMAP_CELLS * MINIMAP_CELLS)};
+}
+
+static void minimap_view_update(MinimapView *view, const Snapshot *snapshot)
+{
+    if (view->texture.id == 0)
+    {
+        Image image = GenImageColor(MINIMAP_COLUMNS, MINIMAP_ROWS, BLANK);
+        view->texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        view->pixels = calloc(MINIMAP_ROWS * MINIMAP_COLUMNS, sizeof(*view->pixels));
+        view->sequence = 0;
+    }
+
+    if (view->sequence == snapshot->sequence)
+    {
+        return;
+    }
+
+    const MinimapChanges *changes = &snapshot->minimap_changes;
+    if (view->sequence != 0 && snapshot->sequence == view->sequence + 1 && !changes->all)
+    {
+        for (uint32_t i = 0; i < changes->count; i++)
+        {
+            Color pixel = minimap_pixel(changes->items[i].count);
+            uint32_t column = changes->items[i].pixel % MINIMAP_COLUMNS;
+            uint32_t row = changes->items[i].pixel / MINIMAP_COLUMNS;
+            UpdateTextureRec(view->texture, (Rectangle){column, row, 1, 1}, &pixel);
+        }
+    }
+    else
+    {
+        // skipped snapshots (or a new game) changed pixels this one doesn't list, so they are counted from the body
+        memset(view->pixels, 0, MINIMAP_ROWS * MINIMAP_COLUMNS * sizeof(*view->pixels));
+        nob_da_foreach(Vector2, segment, &snapshot->snake.body)
+        {
+            view->pixels[(int)segment->y / MINIMAP_CELLS * MINIMAP_COLUMNS + (int)segment->x / MINIMAP_CELLS].a++;
+        }
+        for (int i = 0; i < MINIMAP_ROWS * MINIMAP_COLUMNS; i++)
+        {
+            view->pixels[i] = minimap_pixel(view->pixels[i].a);
+        }
+        UpdateTexture(view->texture, view->pixels);
+    }
+
+    view->sequence = snapshot->sequence;
+}
+
+// in the top right corner, with the food and (when the camera is on) what the window shows
+static void minimap_view_draw(const MinimapView *view, const Snapshot *snapshot, const Layout *layout)
+{
+    float cell_size = (float)MINIMAP_WIDTH / (MINIMAP_COLUMNS * MINIMAP_CELLS);
+    Rectangle dest_rec = {
+        .x = layout->width - MINIMAP_WIDTH - MINIMAP_MARGIN,
+        .y = MINIMAP_MARGIN,
+        .width = MINIMAP_WIDTH,
+        .height = MINIMAP_ROWS * MINIMAP_CELLS * cell_size,
+    };
+
+    DrawRectangleRec(dest_rec, Fade(BLACK, 0.6f));
+    Rectangle source_rec = {0.0f, 0.0f, MINIMAP_COLUMNS, MINIMAP_ROWS};
+    DrawTexturePro(view->texture, source_rec, dest_rec, Vector2Zero(), 0.0f, WHITE);
+
+    Vector2 food_position =
+        Vector2Add((Vector2){dest_rec.x, dest_rec.y}, Vector2Scale(snapshot->food.position, cell_size));
+    DrawRectangleV(food_position, (Vector2){fmaxf(cell_size, 2.0f), fmaxf(cell_size, 2.0f)}, RED);
+
+    if (layout->camera)
+    {
+        Rectangle view_rec = {
+            .x = dest_rec.x - layout->offset.x / layout->diameter * cell_size,
+            .y = dest_rec.y - layout->offset.y / layout->diameter * cell_size,
+            .width = (float)layout->width / layout->diameter * cell_size,
+            .height = (float)layout->height / layout->diameter * cell_size,
+        };
+        DrawRectangleLinesEx(GetCollisionRec(view_rec, dest_rec), 1.0f, RAYWHITE);
+    }
+}
+
+#define CAMERA_DIAMETER 48
+#define CAMERA_DIAMETER_MIN 16
+#define CAMERA_DIAMETER_MAX 128
+#define CAMERA_ZOOM_STEP 8
+
+// follows the head at a fixed cell size instead of fitting the whole board into the window, for boards too big for that
+typedef struct
+{
+    bool enabled;
+    uint8_t diameter;
+} BoardCamera;
+
+static void board_camera_zoom(BoardCamera *camera, int steps)
+{
+    camera->diameter = (uint8_t)Clamp(camera->diameter + steps * CAMERA_ZOOM_STEP, CAMERA_DIAMETER_MIN,
+                                      CAMERA_DIAMETER_MAX);
+}
+
+typedef struct
+{
+    RenderTargets targets;
+    // the sprites first, the much bigger background last
+    AssetId uploaded_assets;
+    Texture2D background;
+    Texture2D sprites;
+    rlRenderBatch board_batch;
+    HudText texts[TEXT_SLOT_COUNT];
+    Layout layout;
+    BoardCamera camera;
+    BoardChunks chunks;
+    BoardOccupancy occupancy;
+    MinimapView minimap;
+    // the board behind the Idle and Lost screens doesn't move, so the scene target keeps it from the first frame it
+    // was drawn for until the snapshot, the size or the textures change
+    struct
+    {
+        bool valid;
+        uint64_t sequence;
+        int snake_step;
+        int food_size;
+    } frozen;
+} Renderer;
+
+static Texture2D *renderer_asset_texture(Renderer *renderer, AssetId id)
+{
+    switch (id)
+    {
+    case ASSET_SPRITES:
+        return &renderer->sprites;
+    case ASSET_BACKGROUND:
+        return &renderer->background;
+    case ASSET_COUNT:
+        break;
+    }
+
+    NOB_UNREACHABLE("renderer_asset_texture");
+}
+
+// everything kept from earlier frames has to be drawn again
+static void renderer_invalidate(Renderer *renderer)
+{
+    renderer->frozen.valid = false;
+    board_chunks_invalidate(&renderer->chunks);
+}
+
+// how the DRAW_STATIC sprites get on screen
+typedef enum
+{
+    STATIC_AS_COMMANDS,
+    STATIC_FROM_CHUNKS,
+    STATIC_FROM_CELL_INDEX,
+    STATIC_FROM_OCCUPANCY,
+} StaticPath;
+
+static StaticPath renderer_static_path(const Renderer *renderer)
+{
+    // the shader needs the atlas
+    if (renderer->occupancy.enabled && renderer->sprites.id != 0)
+    {
+        return STATIC_FROM_OCCUPANCY;
+    }
+    if (renderer->layout.camera)
+    {
+        return STATIC_FROM_CELL_INDEX;
+    }
+    if (board_chunks_match(&renderer->chunks, &renderer->layout))
+    {
+        return STATIC_FROM_CHUNKS;
+    }
+    return STATIC_AS_COMMANDS;
+}
+
+// returns immediately, the textures stay empty (and are drawn as flat colours) until renderer_upload_assets()
+static void renderer_load(Renderer *renderer)
+{
+    *renderer = (Renderer){
+        .board_batch = load_board_batch(),
+        .camera = {.diameter = CAMERA_DIAMETER},
+    };
+}
+
+static bool renderer_assets_loading(const Renderer *renderer)
+{
+    return renderer->uploaded_assets < ASSET_COUNT;
+}
+
+// creates the next texture, returns true when one was created
+static bool renderer_upload_assets(Renderer *renderer)
+{
+    if (!renderer_assets_loading(renderer))
+    {
+        return false;
+    }
+
+    AssetId id = renderer->uploaded_assets++;
+    Texture2D *texture = renderer_asset_texture(renderer, id);
+    *texture = LoadTextureFromImage(asset_image(id));
+
+    if (id == ASSET_SPRITES && IsShaderValid(renderer->occupancy.shader))
+    {
+        board_occupancy_set_atlas(&renderer->occupancy, texture);
+    }
+
+    if (id == ASSET_BACKGROUND)
+    {
+        // only ever sampled when the background layer is built for a new window size, which shrinks it a lot: with
+        // mipmaps that one pass filters properly instead of picking every n-th pixel
+        GenTextureMipmaps(texture);
+        SetTextureFilter(*texture, TEXTURE_FILTER_TRILINEAR);
+
+        if (renderer->targets.background_layer.id != 0)
+        {
+            build_background_layer(renderer->targets.background_layer, texture);
+        }
+    }
+
+    renderer_invalidate(renderer);
+    return true;
+}
+
+// returns true when the board moved or the targets were recreated for a new window size
+static bool renderer_update_size(Renderer *renderer)
+{
+    // with the camera on the layout follows the head instead, see renderer_follow()
+    bool layout_changed =
+        !renderer->camera.enabled && layout_update(&renderer->layout, GetScreenWidth(), GetScreenHeight());
+    bool targets_changed = render_targets_update(&renderer->targets, &renderer->background);
+    if (!layout_changed && !targets_changed)
+    {
+        return false;
+    }
+
+    // the targets are only recreated once the size settles, the chunks with them
+    const Layout *layout = &renderer->layout;
+    if (!layout->camera && !board_chunks_match(&renderer->chunks, layout) && renderer->targets.width == layout->width &&
+        renderer->targets.height == layout->height)
+    {
+        board_chunks_load(&renderer->chunks, layout);
+    }
+    renderer_invalidate(renderer);
+    return true;
+}
+
+static void renderer_toggle_occupancy(Renderer *renderer)
+{
+    BoardOccupancy *occupancy = &renderer->occupancy;
+    renderer_invalidate(renderer);
+
+    if (occupancy->enabled)
+    {
+        occupancy->enabled = false;
+        return;
+    }
+
+    // only compiled once it is asked for, the other paths don't need it
+    if (!IsShaderValid(occupancy->shader))
+    {
+        if (!board_occupancy_load(occupancy))
+        {
+            return;
+        }
+        if (renderer->sprites.id != 0)
+        {
+            board_occupancy_set_atlas(occupancy, &renderer->sprites);
+        }
+    }
+
+    occupancy->enabled = true;
+}
+
+// returns true when the board moved on screen
+static bool renderer_follow(Renderer *renderer, Vector2 head)
+{
+    if (!layout_follow(&renderer->layout, GetScreenWidth(), GetScreenHeight(), renderer->camera.diameter, head))
+    {
+        return false;
+    }
+
+    renderer_invalidate(renderer);
+    return true;
+}
+
+static void renderer_unload(Renderer *renderer)
+{
+    for (TextSlot slot = 0; slot < TEXT_SLOT_COUNT; slot++)
+    {
+        hud_text_unload(&renderer->texts[slot]);
+    }
+    render_targets_unload(&renderer->targets);
+    board_chunks_unload(&renderer->chunks);
+    board_occupancy_unload(&renderer->occupancy);
+    UnloadTexture(renderer->minimap.texture);
+    free(renderer->minimap.pixels);
+    rlUnloadRenderBatch(renderer->board_batch);
+    UnloadTexture(renderer->sprites);
+    UnloadTexture(renderer->background);
+}
+
+static void renderer_draw_commands(Renderer *renderer, const DrawList *list, size_t begin, size_t end,
+                                   int snake_step, int food_size)
+{
+    const Layout *layout = &renderer->layout;
+    float progress = (float)snake_step / layout->diameter;
+    bool in_sprite_batch = false;
+
+    // the other paths draw the DRAW_STATIC sprites themselves, so they are skipped as a whole instead of one by one
+    if (renderer_static_path(renderer) != STATIC_AS_COMMANDS)
+    {
+        begin = max(begin, list->static_end);
+    }
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const DrawCommand *command = &list->items[i];
+
+        if (command->kind == DRAW_SPRITE)
+        {
+            // consecutive sprites share one batch
+            if (!in_sprite_batch)
+            {
+                sprite_batch_begin(&renderer->board_batch, &renderer->sprites);
+                in_sprite_batch = true;
+            }
+
+            Color color = renderer->sprites.id != 0 ? command->tint : command->placeholder;
+            Vector2 position = layout_position(layout, command->from, command->to, progress);
+            int size = command->flags & DRAW_PULSE ? food_size : layout->diameter;
+
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            push_sprite_quad(&renderer->sprites, command->sprite, position.x, position.y, size);
+            continue;
+        }
+
+        if (in_sprite_batch)
+        {
+            sprite_batch_end();
+            in_sprite_batch = false;
+        }
+
+        switch (command->kind)
+        {
+        case DRAW_TEXT_CORNER:
+            draw_corner_hud_text(&renderer->texts[command->text_slot]);
+            break;
+        case DRAW_TEXT_CENTERED:
+            draw_centered_hud_text(&renderer->texts[command->text_slot]);
+            break;
+        default:
+            NOB_UNREACHABLE("renderer_draw_commands");
+        }
+    }
+
+    if (in_sprite_batch)
+    {
+        sprite_batch_end();
+    }
+}
+
+// the background stretched over the whole board, only part of which is on screen
+static void renderer_draw_camera_background(const Renderer *renderer)
+{
+    const Layout *layout = &renderer->layout;
+
+    ClearBackground(BLACK);
+    Rectangle board_rec = {layout->offset.x, layout->offset.y, COLUMNS * layout->diameter, ROWS * layout->diameter};
+    if (renderer->background.id != 0)
+    {
+        Rectangle source_rec = {0.0f, 0.0f, (float)renderer->background.width, (float)renderer->background.height};
+        DrawTexturePro(renderer->background, source_rec, board_rec, Vector2Zero(), 0.0f, WHITE);
+    }
+    else
+    {
+        DrawRectangleRec(board_rec, BACKGROUND_PLACEHOLDER_COLOR);
+    }
+}
+
+// the DRAW_STATIC sprites of the cells on screen, found through the list's index instead of going through the snake
+static void renderer_draw_visible_cells(Renderer *renderer, const DrawList *list, size_t end)
+{
+    const Layout *layout = &renderer->layout;
+
+    int first_column = (int)Clamp(floorf(-layout->offset.x / layout->diameter), 0, COLUMNS);
+    int end_column = (int)Clamp(ceilf((layout->width - layout->offset.x) / layout->diameter), 0, COLUMNS);
+    int first_row = (int)Clamp(floorf(-layout->offset.y / layout->diameter), 0, ROWS);
+    int end_row = (int)Clamp(ceilf((layout->height - layout->offset.y) / layout->diameter), 0, ROWS);
+
+    sprite_batch_begin(&renderer->board_batch, &renderer->sprites);
+    for (int row = first_row; row < end_row; row++)
+    {
+        for (int column = first_column; column < end_column; column++)
+        {
+            uint32_t index = list->static_cells[row][column];
+            if (index == 0 || index > end)
+            {
+                continue;
+            }
+
+            const DrawCommand *command = &list->items[index - 1];
+            Color color = renderer->sprites.id != 0 ? command->tint : command->placeholder;
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            push_sprite_quad(&renderer->sprites, command->sprite, layout->column_x[column], layout->row_y[row],
+                             layout->diameter);
+        }
+    }
+    sprite_batch_end();
+}
+
+// the background and the commands up to end, with the DRAW_STATIC sprites drawn by whatever is fastest for the
+// layout
+static void renderer_draw_board(Renderer *renderer, const DrawList *list, size_t end, int snake_step, int food_size)
+{
+    if (renderer->layout.camera)
+    {
+        renderer_draw_camera_background(renderer);
+    }
+    else
+    {
+        draw_render_texture(renderer->targets.background_layer, WHITE);
+    }
+
+    switch (renderer_static_path(renderer))
+    {
+    case STATIC_AS_COMMANDS:
+        break;
+    case STATIC_FROM_CHUNKS:
+        board_chunks_draw(&renderer->chunks, &renderer->layout);
+        break;
+    case STATIC_FROM_CELL_INDEX:
+        renderer_draw_visible_cells(renderer, list, end);
+        break;
+    case STATIC_FROM_OCCUPANCY:
+        board_occupancy_draw(&renderer->occupancy, &renderer->layout, &renderer->sprites);
+        break;
+    }
+
+    renderer_draw_commands(renderer, list, 0, end, snake_step, food_size);
+}
+
+// the whole frame for a draw list, to be called between BeginDrawing() and EndDrawing()
+static void renderer_draw(Renderer *renderer, const DrawList *list, int snake_step, int food_size)
+{
+    // texts are rendered into their own textures, which can't happen in the middle of texture mode
+    for (TextSlot slot = 0; slot < TEXT_SLOT_COUNT; slot++)
+    {
+        if (list->texts[slot] != 0)
+        {
+            const DrawCommand *command = &list->items[list->texts[slot] - 1];
+            hud_text_update(&renderer->texts[slot], draw_list_text(list, command), command->tint);
+        }
+    }
+    size_t dim_at = list->dim != 0 ? list->dim - 1 : list->count;
+
+    // so are the chunks
+    StaticPath static_path = renderer_static_path(renderer);
+    if (static_path == STATIC_FROM_CHUNKS)
+    {
+        if (renderer->chunks.sequence != list->sequence)
+        {
+            board_chunks_take_cells(&renderer->chunks, list);
+        }
+        board_chunks_redraw(&renderer->chunks, list, &renderer->layout, renderer->targets.background_layer,
+                            &renderer->sprites, &renderer->board_batch);
+    }
+    else if (static_path == STATIC_FROM_OCCUPANCY && renderer->occupancy.sequence != list->sequence)
+    {
+        board_occupancy_take_cells(&renderer->occupancy, list);
+    }
+
+    bool dims = dim_at < list->count;
+    if (!dims)
+    {
+        renderer->frozen.valid = false;
+        renderer_draw_board(renderer, list, list->count, snake_step, food_size);
+        return;
+    }
+
+    // whatever comes before the dim is drawn into the scene target once, which is then drawn greyed out as long as
+    // the screen stays up
+    bool frozen = renderer->frozen.valid && renderer->frozen.sequence == list->sequence &&
+                  renderer->frozen.snake_step == snake_step && renderer->frozen.food_size == food_size;
+    if (!frozen)
+    {
+        BeginTextureMode(renderer->targets.scene);
+        renderer_draw_board(renderer, list, dim_at, snake_step, food_size);
+        EndTextureMode();
+
+        renderer->frozen.valid = true;
+        renderer->frozen.sequence = list->sequence;
+        renderer->frozen.snake_step = snake_step;
+        renderer->frozen.food_size = food_size;
+    }
+
+    draw_render_texture(renderer->targets.scene, GRAY);
+    renderer_draw_commands(renderer, list, dim_at + 1, list->count, snake_step, food_size);
+}
+
+// draws the same board as the raylib renderer into an RGBA framebuffer on the CPU, for machines without a GPU: replay
+// thumbnails, images for visual regression tests and frames for videos
+
+#define SOFTWARE_WIDTH 800
+#define SOFTWARE_HEIGHT 600
+
+// food pulses from 100% to 110% of the diameter, which is at most 26 different sizes for a uint8_t diameter
+#define SOFTWARE_FOOD_SIZES 32
+
+#define SOFTWARE_FONT_WIDTH 5
+#define SOFTWARE_FONT_HEIGHT 7
+#define SOFTWARE_FONT_SCALE (HUD_FONT_SIZE / 10)
+
+#define SOFTWARE_LINE_HEIGHT (SOFTWARE_FONT_HEIGHT + 3)
+
+// rows of SOFTWARE_FONT_WIDTH bits, the leftmost pixel in the highest bit. only what the game's texts need, anything
+// else is drawn as a space
+static const uint8_t software_font[128][SOFTWARE_FONT_HEIGHT] = {
+    ['0'] = {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, ['1'] = {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E},
+    ['2'] = {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, ['3'] = {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E},
+    ['4'] = {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, ['5'] = {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E},
+    ['6'] = {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, ['7'] = {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    ['8'] = {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, ['9'] = {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C},
+    [':'] = {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, ['S'] = {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E},
+    ['c'] = {0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E}, ['o'] = {0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E},
+    ['r'] = {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, ['e'] = {0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E},
+    ['a'] = {0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F}, ['g'] = {0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E},
+    ['h'] = {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, ['i'] = {0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E},
+    ['k'] = {0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12}, ['m'] = {0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11},
+    ['n'] = {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, ['s'] = {0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E},
+    ['t'] = {0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06}, ['v'] = {0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04},
+    ['w'] = {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A}, ['y'] = {0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E},
+    ['A'] = {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, ['D'] = {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C},
+    ['L'] = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, ['M'] = {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11},
+    ['U'] = {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, ['W'] = {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A},
+    ['!'] = {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, ['('] = {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02},
+    [')'] = {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, ['.'] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C},
+};
+
+typedef struct
+{
+    int width;
+    int height;
+    Color *pixels;
+    // full size, as they come from the assets
+    Image sprites;
+    Image background;
+    // the scaled background with the borders, copied as a whole at the start of every frame
+    Image backdrop;
+    // everything below is scaled for this layout, empty until the first frame
+    Layout layout;
+    // scaled (and tinted) the first time they are drawn
+    Image scaled_sprites[SPRITE_COUNT];
+    Color scaled_tints[SPRITE_COUNT];
+    // pulsing sprites by their size above the diameter, there is only ever the food
+    Image scaled_pulsing[SOFTWARE_FOOD_SIZES];
+} SoftwareRenderer;
+
+static void software_renderer_unload_scaled(SoftwareRenderer *renderer)
+{
+    for (size_t i = 0; i < NOB_ARRAY_LEN(renderer->scaled_sprites); i++)
+    {
+        UnloadImage(renderer->scaled_sprites[i]);
+        renderer->scaled_sprites[i] = (Image){0};
+    }
+    for (size_t i = 0; i < NOB_ARRAY_LEN(renderer->scaled_pulsing); i++)
+    {
+        UnloadImage(renderer->scaled_pulsing[i]);
+        renderer->scaled_pulsing[i] = (Image){0};
+    }
+    UnloadImage(renderer->backdrop);
+    renderer->backdrop = (Image){0};
+}
+
+static void software_renderer_unload(SoftwareRenderer *renderer)
+{
+    software_renderer_unload_scaled(renderer);
+    UnloadImage(renderer->background);
+    UnloadImage(renderer->sprites);
+    free(renderer->pixels);
+}
+
+static Image software_scale_sprite(const SoftwareRenderer *renderer, SpriteId sprite, int size, Color tint)
+{
+    Image scaled = ImageFromImage(renderer->sprites, sprite_rects[sprite]);
+    ImageResize(&scaled, size, size);
+    ImageColorTint(&scaled, tint);
+    return scaled;
+}
+
+// all the resampling happens here, once per layout, so a frame is nothing but copies and blends
+static void software_renderer_layout(SoftwareRenderer *renderer)
+{
+    if (!layout_update(&renderer->layout, renderer->width, renderer->height))
+    {
+        return;
+    }
+
+    software_renderer_unload_scaled(renderer);
+
+    Vector2 offset = renderer->layout.offset;
+    renderer->backdrop = ImageCopy(renderer->background);
+    ImageResize(&renderer->backdrop, renderer->width, renderer->height);
+    ImageDrawRectangle(&renderer->backdrop, 0, 0, renderer->width, offset.y, BLACK);
+    ImageDrawRectangle(&renderer->backdrop, 0, renderer->height - offset.y, renderer->width, offset.y, BLACK);
+    ImageDrawRectangle(&renderer->backdrop, 0, 0, offset.x, renderer->height, BLACK);
+    ImageDrawRectangle(&renderer->backdrop, renderer->width - offset.x, 0, offset.x, renderer->height, BLACK);
+}
+
+static void software_renderer_load(SoftwareRenderer *renderer, int width, int height)
+{
+    *renderer = (SoftwareRenderer){
+        .width = width,
+        .height = height,
+        .pixels = malloc((size_t)width * height * sizeof(Color)),
+    };
+
+    // the sources as RGBA copies, the embedded images are read only
+    renderer->sprites = ImageCopy(embedded_sprites);
+    ImageFormat(&renderer->sprites, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    renderer->background = ImageCopy(embedded_background);
+    ImageFormat(&renderer->background, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    software_renderer_layout(renderer);
+}
+
+static const Image *software_sprite(SoftwareRenderer *renderer, const DrawCommand *command, int food_size)
+{
+    if (command->flags & DRAW_PULSE)
+    {
+        int index = food_size - renderer->layout.diameter;
+        assert(index >= 0 && index < SOFTWARE_FOOD_SIZES);
+
+        Image *scaled = &renderer->scaled_pulsing[index];
+        if (scaled->data == NULL)
+        {
+            *scaled = software_scale_sprite(renderer, command->sprite, food_size, command->tint);
+        }
+        return scaled;
+    }
+
+    Image *scaled = &renderer->scaled_sprites[command->sprite];
+    if (scaled->data == NULL || !ColorIsEqual(renderer->scaled_tints[command->sprite], command->tint))
+    {
+        UnloadImage(*scaled);
+        *scaled = software_scale_sprite(renderer, command->sprite, renderer->layout.diameter, command->tint);
+        renderer->scaled_tints[command->sprite] = command->tint;
+    }
+    return scaled;
+}
+
+// source over an opaque destination: dst = src * a + dst * (1 - a), in 8 bit fixed point
+static void blend_span(Color *dst, const Color *src, int count)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000);
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i half = _mm_set1_epi16(128);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i *)&src[i]);
+        __m128i alpha = _mm_and_si128(source, alpha_mask);
+
+        // most pixels of a sprite are either fully transparent or fully opaque
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, zero)) == 0xFFFF)
+        {
+            continue;
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, alpha_mask)) == 0xFFFF)
+        {
+            _mm_storeu_si128((__m128i *)&dst[i], source);
+            continue;
+        }
+
+        __m128i destination = _mm_loadu_si128((const __m128i *)&dst[i]);
+
+        // two pixels per register as 16 bit channels, the alpha of each pixel copied into all four of its channels
+        __m128i source_lo = _mm_unpacklo_epi8(source, zero);
+        __m128i source_hi = _mm_unpackhi_epi8(source, zero);
+        __m128i destination_lo = _mm_unpacklo_epi8(destination, zero);
+        __m128i destination_hi = _mm_unpackhi_epi8(destination, zero);
+        __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source_lo, 0xFF), 0xFF);
+        __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(source_hi, 0xFF), 0xFF);
+
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(source_lo, alpha_lo),
+                                   _mm_mullo_epi16(destination_lo, _mm_sub_epi16(full, alpha_lo)));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(source_hi, alpha_hi),
+                                   _mm_mullo_epi16(destination_hi, _mm_sub_epi16(full, alpha_hi)));
+
+        // x / 255 rounded, as (x + 128 + ((x + 128) >> 8)) >> 8
+        lo = _mm_add_epi16(lo, half);
+        hi = _mm_add_epi16(hi, half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        __m128i blended = _mm_or_si128(_mm_packus_epi16(lo, hi), alpha_mask);
+        _mm_storeu_si128((__m128i *)&dst[i], blended);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        unsigned int alpha = src[i].a;
+        if (alpha == 0)
+        {
+            continue;
+        }
+
+#define BLEND_CHANNEL(channel)                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        unsigned int x = src[i].channel * alpha + dst[i].channel * (255 - alpha) + 128;                                \
+        dst[i].channel = (unsigned char)((x + (x >> 8)) >> 8);                                                         \
+    } while (0)
+
+        BLEND_CHANNEL(r);
+        BLEND_CHANNEL(g);
+        BLEND_CHANNEL(b);
+        dst[i].a = 255;
+
+#undef BLEND_CHANNEL
+    }
+}
+
+static void software_blit(SoftwareRenderer *renderer, const Image *sprite, int x, int y)
+{
+    int left = max(x, 0);
+    int top = max(y, 0);
+    int right = min(x + sprite->width, renderer->width);
+    int bottom = min(y + sprite->height, renderer->height);
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    const Color *source = sprite->data;
+    for (int row = top; row < bottom; row++)
+    {
+        blend_span(&renderer->pixels[row * renderer->width + left], &source[(row - y) * sprite->width + (left - x)],
+                   right - left);
+    }
+}
+
+static void software_fill_rect(SoftwareRenderer *renderer, int x, int y, int width, int height, Color color)
+{
+    for (int row = max(y, 0); row < (min(y + height, renderer->height)); row++)
+    {
+        for (int column = max(x, 0); column < (min(x + width, renderer->width)); column++)
+        {
+            renderer->pixels[row * renderer->width + column] = color;
+        }
+    }
+}
+
+static Vector2 software_measure_text(const char *text)
+{
+    int longest_line = 0;
+    int lines = 1;
+    int line = 0;
+
+    for (const char *c = text; *c != '\0'; c++)
+    {
+        if (*c == '\n')
+        {
+            lines++;
+            line = 0;
+            continue;
+        }
+        line++;
+        longest_line = max(longest_line, line);
+    }
+
+    return (Vector2){
+        .x = longest_line > 0 ? (longest_line * (SOFTWARE_FONT_WIDTH + 1) - 1) * SOFTWARE_FONT_SCALE : 0,
+        .y = ((lines - 1) * SOFTWARE_LINE_HEIGHT + SOFTWARE_FONT_HEIGHT) * SOFTWARE_FONT_SCALE,
+    };
+}
+
+static void software_draw_text(SoftwareRenderer *renderer, const char *text, int x, int y, Color color)
+{
+    int line_x = x;
+
+    for (const char *c = text; *c != '\0'; c++, x += (SOFTWARE_FONT_WIDTH + 1) * SOFTWARE_FONT_SCALE)
+    {
+        if (*c == '\n')
+        {
+            // advanced again by the loop
+            x = line_x - (SOFTWARE_FONT_WIDTH + 1) * SOFTWARE_FONT_SCALE;
+            y += SOFTWARE_LINE_HEIGHT * SOFTWARE_FONT_SCALE;
+            continue;
+        }
+
+        const uint8_t *glyph = software_font[(unsigned char)*c & 127];
+        for (int row = 0; row < SOFTWARE_FONT_HEIGHT; row++)
+        {
+            for (int column = 0; column < SOFTWARE_FONT_WIDTH; column++)
+            {
+                if (glyph[row] & (1 << (SOFTWARE_FONT_WIDTH - 1 - column)))
+                {
+                    software_fill_rect(renderer, x + column * SOFTWARE_FONT_SCALE, y + row * SOFTWARE_FONT_SCALE,
+                                       SOFTWARE_FONT_SCALE, SOFTWARE_FONT_SCALE, color);
+                }
+            }
+        }
+    }
+}
+
+// GRAY over everything drawn so far, like the raylib backend tints the scene target
+static void software_dim(SoftwareRenderer *renderer)
+{
+    size_t count = (size_t)renderer->width * renderer->height;
+    for (size_t i = 0; i < count; i++)
+    {
+        Color *pixel = &renderer->pixels[i];
+        pixel->r = (unsigned char)(pixel->r * GRAY.r / 255);
+        pixel->g = (unsigned char)(pixel->g * GRAY.g / 255);
+        pixel->b = (unsigned char)(pixel->b * GRAY.b / 255);
+    }
+}
+
+// the software backend of a draw list
+static void software_renderer_draw(SoftwareRenderer *renderer, const DrawList *list, int snake_step, int food_size)
+{
+    float progress = (float)snake_step / renderer->layout.diameter;
+
+    memcpy(renderer->pixels, renderer->backdrop.data, (size_t)renderer->width * renderer->height * sizeof(Color));
+
+    nob_da_foreach(DrawCommand, command, list)
+    {
+        switch (command->kind)
+        {
+        case DRAW_SPRITE: {
+            Vector2 position = layout_position(&renderer->layout, command->from, command->to, progress);
+            software_blit(renderer, software_sprite(renderer, command, food_size), (int)roundf(position.x),
+                          (int)roundf(position.y));
+            break;
+        }
+        case DRAW_TEXT_CORNER: {
+            const char *text = draw_list_text(list, command);
+            Vector2 position = Vector2Scale(software_measure_text(text), 0.5f);
+            software_draw_text(renderer, text, (int)position.x, (int)position.y, command->tint);
+            break;
+        }
+        case DRAW_TEXT_CENTERED: {
+            const char *text = draw_list_text(list, command);
+            Vector2 size = software_measure_text(text);
+            software_draw_text(renderer, text, (int)(renderer->width / 2 - size.x / 2),
+                               (int)(renderer->height / 2 - size.y / 2), command->tint);
+            break;
+        }
+        case DRAW_DIM:
+            software_dim(renderer);
+            break;
+        }
+    }
+}
+
+static bool software_renderer_export(const SoftwareRenderer *renderer, const char *path)
+{
+    Image frame = {
+        .data = renderer->pixels,
+        .width = renderer->width,
+        .height = renderer->height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    return ExportImage(frame, path);
+}
 
-        uint8_t diameter = calculate_diameter();
-        float used_x = diameter * COLUMNS;
-        float used_y = diameter * ROWS;
-        Vector2 offset = {
-            .x = (width - used_x) / 2,
-            .y = (height - used_y) / 2,
-        };
+// keeps the snake alive for as long as it can: the free neighbour cell closest to the food, never a reversal
+static Vector2 autopilot_direction(void)
+{
+    const Vector2 directions[] = {DIRECTION_UP, DIRECTION_DOWN, DIRECTION_LEFT, DIRECTION_RIGHT};
+
+    Vector2 best = snake.direction;
+    float best_distance = INFINITY;
+
+    for (size_t i = 0; i < NOB_ARRAY_LEN(directions); i++)
+    {
+        if (is_opposite_direction(directions[i], snake.direction))
+        {
+            continue;
+        }
 
-        draw_borders(offset);
+        Vector2 next = Vector2Add(snake.body.items[0], directions[i]);
+        if (next.x < 0 || next.x >= COLUMNS || next.y < 0 || next.y >= ROWS || is_location_inside_snake(next, &snake))
+        {
+            continue;
+        }
 
-        draw_snake(&snake, &snake_atlas, &snake_atlas_definition, diameter, offset);
+        float distance = fabsf(next.x - food.position.x) + fabsf(next.y - food.position.y);
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            best = directions[i];
+        }
+    }
 
-        draw_food(&food, &food_animation_timing, &apple_texture, diameter, offset, GetFrameTime());
+    return best;
+}
 
-        draw_score(foods_eaten);
+#define BENCH_AUTOPILOT_SEED 1
+#define BENCH_TICKS 200000
+#define BENCH_FRAMES 2000
 
-        if (state == Idle || state == Lost)
+typedef struct
+{
+    const char *name;
+    // NULL for the autopilot
+    const Replay *replay;
+    uint64_t ticks;
+    uint64_t games;
+    // replays that did not end on their recorded tick
+    uint64_t diverged;
+    uint64_t ns;
+    uint64_t frames;
+    uint64_t frame_ns;
+    uint64_t frame_ns_max;
+    uint64_t software_frames;
+    uint64_t software_frame_ns;
+    // building the draw list and walking it with the null backend
+    uint64_t list_ns;
+    uint64_t list_checksum;
+    // made by the ticks, the restarts and the snapshots, 0 unless something allocates on the way (debug builds only)
+    uint64_t heap_operations;
+} BenchResult;
+
+// one simulation step of a bench scenario, a lost game starts over with the next one
+static void bench_step(BenchResult *result, size_t *next_turn)
+{
+    if (state != Playing)
+    {
+        *next_turn = 0;
+        result->games++;
+        if (result->replay != NULL)
         {
-            EndTextureMode();
+            start_game(result->replay->start_direction, result->replay->seed);
+        }
+        else
+        {
+            start_game(snake.direction, BENCH_AUTOPILOT_SEED + (unsigned int)result->games);
+        }
+    }
+
+    // the same bookkeeping accumulator_tick() does for a due tick
+    move_timing.ticks++;
+
+    if (result->replay != NULL)
+    {
+        const ReplayTurns *turns = &result->replay->turns;
+        if (*next_turn < turns->count && turns->items[*next_turn].tick == move_timing.ticks)
+        {
+            input_queue_push(&input_queue, turns->items[(*next_turn)++].direction, 0);
+        }
+    }
+    else
+    {
+        input_queue_push(&input_queue, autopilot_direction(), 0);
+    }
+
+    uint64_t tick = move_timing.ticks;
+    DirectionInput turn;
+    game_tick(&turn);
+    input_queue_commit(&input_queue);
+    result->ticks++;
+
+    if (state != Playing && result->replay != NULL && tick != result->replay->end_tick)
+    {
+        result->diverged++;
+    }
+}
+
+static void bench_reset(void)
+{
+    state = Idle;
+    setup();
+}
+
+// ticks as fast as possible with nothing else going on, then draws one frame per tick in software and (with a window)
+// on the GPU
+static void bench_run(BenchResult *result, Renderer *renderer, SoftwareRenderer *software)
+{
+    size_t next_turn = 0;
+
+    bench_reset();
+    size_t heap_operations_before = heap_operations_count();
+    uint64_t start_ns = nob_nanos_since_unspecified_epoch();
+    while (result->ticks < BENCH_TICKS)
+    {
+        bench_step(result, &next_turn);
+    }
+    result->ns = nob_nanos_since_unspecified_epoch() - start_ns;
+    result->heap_operations += heap_operations_count() - heap_operations_before;
+
+    BenchResult frames_result = *result;
+    Snapshot snapshot = {0};
+    snapshot_reserve(&snapshot);
+    uint8_t software_diameter = software->layout.diameter;
+
+    bench_reset();
+    for (uint64_t frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        heap_operations_before = heap_operations_count();
+        bench_step(&frames_result, &next_turn);
+        snapshot_capture(&snapshot, frame + 1, 0);
+        result->heap_operations += heap_operations_count() - heap_operations_before;
+
+        uint64_t list_start_ns = nob_nanos_since_unspecified_epoch();
+        draw_list_build(&snapshot.draw_list, &snapshot);
+        result->list_checksum += null_draw(&snapshot.draw_list, frame % software_diameter, software_diameter);
+        result->list_ns += nob_nanos_since_unspecified_epoch() - list_start_ns;
+
+        uint64_t frame_start_ns = nob_nanos_since_unspecified_epoch();
+        software_renderer_draw(software, &snapshot.draw_list, frame % software_diameter, software_diameter);
+        result->software_frame_ns += nob_nanos_since_unspecified_epoch() - frame_start_ns;
+        result->software_frames++;
+    }
+
+    if (renderer == NULL)
+    {
+        snapshot_free(&snapshot);
+        return;
+    }
+
+    bench_reset();
+    for (uint64_t frame = 0; frame < BENCH_FRAMES; frame++)
+    {
+        bench_step(&frames_result, &next_turn);
+        snapshot_capture(&snapshot, frame + 1, 0);
+        renderer_update_size(renderer);
+
+        uint64_t frame_start_ns = nob_nanos_since_unspecified_epoch();
+        BeginDrawing();
+        uint8_t diameter = renderer->layout.diameter;
+        renderer_draw(renderer, &snapshot.draw_list, frame % diameter, diameter);
+        EndDrawing();
+        uint64_t frame_ns = nob_nanos_since_unspecified_epoch() - frame_start_ns;
+
+        result->frames++;
+        result->frame_ns += frame_ns;
+        result->frame_ns_max = max(result->frame_ns_max, frame_ns);
+
+        nob_temp_reset();
+    }
+
+    snapshot_free(&snapshot);
+}
+
+static void bench_print(const BenchResult *result)
+{
+    double seconds = (double)result->ns / NS_PER_SECOND;
+    double frame_avg_ms = result->frames > 0 ? (double)result->frame_ns / result->frames / NS_PER_MS : 0.0;
+    double software_frame_avg_ms =
+        result->software_frames > 0 ? (double)result->software_frame_ns / result->software_frames / NS_PER_MS : 0.0;
+    double list_avg_ms =
+        result->software_frames > 0 ? (double)result->list_ns / result->software_frames / NS_PER_MS : 0.0;
+
+    // one line per scenario, `nob pgo` parses these
+    printf("bench %s ticks=%lu games=%lu diverged=%lu ticks_per_second=%.0f frame_avg_ms=%.4f frame_max_ms=%.4f "
+           "software_frame_avg_ms=%.4f list_avg_ms=%.4f",
+           result->name, result->ticks, result->games, result->diverged, result->ticks / seconds, frame_avg_ms,
+           (double)result->frame_ns_max / NS_PER_MS, software_frame_avg_ms, list_avg_ms);
+#ifndef NDEBUG
+    printf(" heap_operations=%lu", result->heap_operations);
+#endif
+    printf("\n");
+}
+
+static bool collect_replays(const char *path, Nob_File_Paths *replays)
+{
+    Nob_File_Type type = nob_get_file_type(path);
+    if (type < 0)
+    {
+        return false;
+    }
+
+    if (type != NOB_FILE_DIRECTORY)
+    {
+        nob_da_append(replays, path);
+        return true;
+    }
+
+    Nob_File_Paths children = {0};
+    if (!nob_read_entire_dir(path, &children))
+    {
+        return false;
+    }
+
+    nob_da_foreach(const char *, child, &children)
+    {
+        if (nob_sv_end_with(nob_sv_from_cstr(*child), ".replay"))
+        {
+            // not a temp string, the frame pass resets the temp allocator
+            nob_da_append(replays, strdup(nob_temp_sprintf("%s/%s", path, *child)));
+        }
+    }
+
+    nob_da_free(children);
+    return true;
+}
+
+// the autopilot scenario plus every given replay, timed headless; GPU frame times need a (hidden) window
+static int bench(Nob_File_Paths paths, bool headless)
+{
+    Nob_File_Paths replay_paths = {0};
+    nob_da_foreach(const char *, path, &paths)
+    {
+        if (!collect_replays(*path, &replay_paths))
+        {
+            return 1;
+        }
+    }
+
+    Renderer renderer = {0};
+    bool has_window = false;
+    if (!headless)
+    {
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow(800, 600, "Snake Game in Raylib");
+        has_window = IsWindowReady();
+        if (has_window)
+        {
+            renderer_load(&renderer);
+            // frame times are measured with the real textures, not the placeholders
+            while (renderer_upload_assets(&renderer))
+            {
+            }
+        }
+        else
+        {
+            TraceLog(LOG_WARNING, "No window available, skipping GPU frame times");
+        }
+    }
+
+    SoftwareRenderer software;
+    software_renderer_load(&software, SOFTWARE_WIDTH, SOFTWARE_HEIGHT);
+
+    BenchResult autopilot = {.name = "autopilot"};
+    bench_run(&autopilot, has_window ? &renderer : NULL, &software);
+    bench_print(&autopilot);
+
+    nob_da_foreach(const char *, path, &replay_paths)
+    {
+        Replay replay = {0};
+        if (!replay_load(*path, &replay))
+        {
+            return 1;
+        }
+
+        BenchResult result = {.name = *path, .replay = &replay};
+        bench_run(&result, has_window ? &renderer : NULL, &software);
+        bench_print(&result);
+
+        nob_da_free(replay.turns);
+    }
+
+    software_renderer_unload(&software);
+
+    if (has_window)
+    {
+        renderer_unload(&renderer);
+        CloseWindow();
+    }
+
+    return 0;
+}
+
+#define RENDER_FRAMES_PER_TICK 4
+
+// the game of a replay rendered in software, no window or GPU needed: <output dir>/frame_000000.png and onwards
+static int render_replay(const char *replay_path, const char *output_dir)
+{
+    Replay replay = {0};
+    if (!replay_load(replay_path, &replay) || !nob_mkdir_if_not_exists(output_dir))
+    {
+        return 1;
+    }
+
+    SoftwareRenderer software;
+    software_renderer_load(&software, SOFTWARE_WIDTH, SOFTWARE_HEIGHT);
+    uint8_t diameter = software.layout.diameter;
+
+    BenchResult result = {.name = replay_path, .replay = &replay};
+    Snapshot snapshot = {0};
+    snapshot_reserve(&snapshot);
+    size_t next_turn = 0;
+    uint64_t frame = 0;
+    int exit_code = 0;
+
+    bench_reset();
+    for (;;)
+    {
+        bench_step(&result, &next_turn);
+        // the game is reset as soon as it is lost, there is nothing of it left to draw
+        if (state != Playing)
+        {
+            break;
+        }
+
+        snapshot_capture(&snapshot, result.ticks, 0);
+        for (int i = 1; i <= RENDER_FRAMES_PER_TICK; i++)
+        {
+            software_renderer_draw(&software, &snapshot.draw_list, diameter * i / RENDER_FRAMES_PER_TICK, diameter);
+            if (!software_renderer_export(&software, nob_temp_sprintf("%s/frame_%06lu.png", output_dir, frame++)))
+            {
+                exit_code = 1;
+                goto defer;
+            }
+            nob_temp_reset();
+        }
+    }
+
+    if (result.diverged > 0)
+    {
+        TraceLog(LOG_WARNING, "%s did not end on its recorded tick %lu", replay_path, replay.end_tick);
+    }
+    TraceLog(LOG_INFO, "Rendered %lu frames of %s to %s", frame, replay_path, output_dir);
+
+defer:
+    snapshot_free(&snapshot);
+    software_renderer_unload(&software);
+    nob_da_free(replay.turns);
+    return exit_code;
+}
+
+static void usage(const char *program_name)
+{
+    fprintf(stderr,
+            "usage: %s [--record <dir>] [--latency-log <file>] [--bench [--headless] [replays or dirs of replays...]] "
+            "[--render <replay> <output dir>]\n",
+            program_name);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t startup_ns = nob_nanos_since_unspecified_epoch();
+
+    const char *program_name = nob_shift(argv, argc);
+
+    bool run_bench = false;
+    bool headless = false;
+    const char *latency_log_path = NULL;
+    Nob_File_Paths bench_paths = {0};
+
+    while (argc > 0)
+    {
+        const char *flag = nob_shift(argv, argc);
+
+        if (strcmp(flag, "--record") == 0)
+        {
+            if (argc == 0)
+            {
+                usage(program_name);
+                return 1;
+            }
+            record_dir = nob_shift(argv, argc);
+            if (!nob_mkdir_if_not_exists(record_dir))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(flag, "--latency-log") == 0)
+        {
+            if (argc == 0)
+            {
+                usage(program_name);
+                return 1;
+            }
+            latency_log_path = nob_shift(argv, argc);
+        }
+        else if (strcmp(flag, "--bench") == 0)
+        {
+            run_bench = true;
+        }
+        else if (strcmp(flag, "--render") == 0)
+        {
+            if (argc < 2)
+            {
+                usage(program_name);
+                return 1;
+            }
+            const char *replay_path = nob_shift(argv, argc);
+            const char *output_dir = nob_shift(argv, argc);
+            return render_replay(replay_path, output_dir);
+        }
+        else if (strcmp(flag, "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if (run_bench && flag[0] != '-')
+        {
+            nob_da_append(&bench_paths, flag);
+        }
+        else
+        {
+            usage(program_name);
+            return 1;
+        }
+    }
+
+    if (run_bench)
+    {
+        return bench(bench_paths, headless);
+    }
+
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(800, 600, "Snake Game in Raylib");
+    TraceLog(LOG_INFO, "Startup: window ready after %.2f ms",
+             (double)(nob_nanos_since_unspecified_epoch() - startup_ns) / NS_PER_MS);
+
+    // frames are paced by wait_for_next_frame() instead, which keeps sampling input while it waits
+    SetTargetFPS(0);
+
+    setup();
+
+    if (latency_log_path != NULL)
+    {
+        latency_open_log(&latency_stats, latency_log_path);
+    }
+
+    bool show_debug_overlay = false;
+    bool show_minimap = false;
+
+    Renderer renderer = {0};
+    renderer_load(&renderer);
+
+    simulation_start(&simulation);
+
+    // frames are only rendered when something on screen changed, otherwise the loop just polls (or waits for) input
+    bool needs_redraw = true;
+    int last_food_size = 0;
+    int last_snake_step = 0;
+    uint64_t last_sequence = 0;
+    uint64_t last_frame_start_ns = nob_nanos_since_unspecified_epoch();
+    bool first_frame_presented = false;
+
+    while (!WindowShouldClose())
+    {
+        uint64_t frame_start_ns = nob_nanos_since_unspecified_epoch();
+        // GetFrameTime() only advances on rendered frames
+        uint64_t dt_ns = frame_start_ns - last_frame_start_ns;
+        last_frame_start_ns = frame_start_ns;
+
+        if (input_queue.camera_toggled)
+        {
+            input_queue.camera_toggled = false;
+            renderer.camera.enabled = !renderer.camera.enabled;
+            needs_redraw = true;
+        }
+
+        if (input_queue.occupancy_toggled)
+        {
+            input_queue.occupancy_toggled = false;
+            renderer_toggle_occupancy(&renderer);
+            needs_redraw = true;
+        }
+
+        if (input_queue.zoom_steps != 0)
+        {
+            board_camera_zoom(&renderer.camera, input_queue.zoom_steps);
+            input_queue.zoom_steps = 0;
+            needs_redraw = true;
+        }
+
+        if (renderer_update_size(&renderer))
+        {
+            needs_redraw = true;
+        }
+
+        if (renderer_assets_loading(&renderer) && renderer_upload_assets(&renderer))
+        {
+            needs_redraw = true;
+            if (!renderer_assets_loading(&renderer))
+            {
+                TraceLog(LOG_INFO, "Startup: all textures loaded after %.2f ms",
+                         (double)(nob_nanos_since_unspecified_epoch() - startup_ns) / NS_PER_MS);
+            }
+        }
+
+        if (input_queue.debug_overlay_toggled)
+        {
+            input_queue.debug_overlay_toggled = false;
+            show_debug_overlay = !show_debug_overlay;
+            needs_redraw = true;
+        }
+
+        if (input_queue.minimap_toggled)
+        {
+            input_queue.minimap_toggled = false;
+            show_minimap = !show_minimap;
+            needs_redraw = true;
+        }
+
+        const Snapshot *snapshot = simulation_latest(&simulation);
+        if (snapshot->sequence != last_sequence)
+        {
+            last_sequence = snapshot->sequence;
+            needs_redraw = true;
+        }
+
+        // the board is frozen behind the Idle and Lost screens, including the food pulse
+        bool animating = snapshot->state == Playing;
+        if (animating)
+        {
+            accumulator_advance(&food_animation_timing, dt_ns);
+            while (accumulator_tick(&food_animation_timing))
+            {
+            }
+        }
+
+        uint8_t diameter = renderer.camera.enabled ? renderer.camera.diameter : renderer.layout.diameter;
+
+        int current_food_size = food_size(&food_animation_timing, diameter);
+        if (current_food_size != last_food_size)
+        {
+            last_food_size = current_food_size;
+            needs_redraw = true;
+        }
+
+        // how far into the next cell the snake is drawn, snapped to whole pixels like the food pulse
+        int snake_step = animating ? (int)(snapshot_progress(snapshot, frame_start_ns) * diameter) : diameter;
+        if (snake_step != last_snake_step)
+        {
+            last_snake_step = snake_step;
+            needs_redraw = true;
+        }
+
+        if (renderer.camera.enabled &&
+            renderer_follow(&renderer, snapshot_head(snapshot, (float)snake_step / diameter)))
+        {
+            needs_redraw = true;
         }
 
-        if (state == Idle)
+        if (show_debug_overlay)
+        {
+            needs_redraw = true;
+        }
+
+        // a pending resize has to be picked up once the debounce elapses, even without new events, and a press the
+        // simulation has not taken yet may still change the state
+        bool waits_for_events = !animating && !render_targets_resize_pending(&renderer.targets) &&
+                                input_queue_drained(&input_queue) && !renderer_assets_loading(&renderer);
+        if (waits_for_events)
+        {
+            EnableEventWaiting();
+        }
+        else
         {
-            DrawTextureRec(target.texture,
-                           (Rectangle){0, 0, (float)target.texture.width, (float)-target.texture.height}, Vector2Zero(),
-                           GRAY);
+            DisableEventWaiting();
+        }
 
-            const char *text = "Use arrow keys (or WASD) to move the snake";
-            const size_t font_size = 20;
-            Vector2 text_size = MeasureTextEx(GetFontDefault(), text, font_size, 0);
-            DrawText(text,
-                     GetScreenWidth() / 2 - text_size.x / 2,             //
-                     GetScreenHeight() / 2 - text_size.y / 2, font_size, //
-                     YELLOW);
+        if (!needs_redraw)
+        {
+            if (waits_for_events)
+            {
+                PollInputEvents();
+                poll_input(&input_queue);
+            }
+            else
+            {
+                wait_for_next_frame(&input_queue, frame_start_ns);
+            }
+            continue;
         }
 
-        else if (state == Lost)
+        needs_redraw = false;
+
+        BeginDrawing();
+
+        renderer_draw(&renderer, &snapshot->draw_list, snake_step, current_food_size);
+
+        if (show_minimap)
         {
-            DrawTextureRec(target.texture,
-                           (Rectangle){0, 0, (float)target.texture.width, (float)-target.texture.height}, Vector2Zero(),
-                           GRAY);
+            minimap_view_update(&renderer.minimap, snapshot);
+            minimap_view_draw(&renderer.minimap, snapshot, &renderer.layout);
+        }
 
-            const char *text = nob_temp_sprintf("Lost! Score: %2lu\nMove again to restart.", foods_eaten);
-            const size_t font_size = 20;
-            Vector2 text_size = MeasureTextEx(GetFontDefault(), text, font_size, 0);
-            DrawText(text,
-                     GetScreenWidth() / 2 - text_size.x / 2,             //
-                     GetScreenHeight() / 2 - text_size.y / 2, font_size, //
-                     YELLOW);
+        if (show_debug_overlay)
+        {
+            draw_debug_overlay(&renderer.targets, snapshot, &latency_stats);
         }
 
         EndDrawing();
+        latency_frame_presented(&latency_stats, nob_nanos_since_unspecified_epoch(), snapshot->sequence);
+
+        if (!first_frame_presented)
+        {
+            first_frame_presented = true;
+            TraceLog(LOG_INFO, "Startup: first frame presented after %.2f ms",
+                     (double)(nob_nanos_since_unspecified_epoch() - startup_ns) / NS_PER_MS);
+        }
+        poll_input(&input_queue);
+
+        if (!waits_for_events)
+        {
+            wait_for_next_frame(&input_queue, frame_start_ns);
+        }
 
         nob_temp_reset();
     }
+
+    simulation_stop(&simulation);
+
+    renderer_unload(&renderer);
+
+    latency_close_log(&latency_stats);
+
+    CloseWindow();
+
+    return 0;
 }
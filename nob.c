@@ -3,19 +3,363 @@
 #define NOB_EXPERIMENTAL_DELETE_OLD
 #include "nob.h"
 
+#define BUILD_DIR "build/"
+#define RAYLIB_DIR "./libs/raylib-5.5_linux_amd64/"
+#define PGO_DIR BUILD_DIR "pgo/"
+#define ASSETS_DIR BUILD_DIR "assets"
+#define EMBEDDED_ASSETS_SOURCE ASSETS_DIR "/embedded_assets.c"
+#define EMBEDDED_ASSETS_OBJECT ASSETS_DIR "/embedded_assets.o"
+// the committed corpus of recorded games (`main --record replays` adds to it), used for training and comparing
+#define REPLAYS_DIR "replays"
+
+typedef enum
+{
+    CONFIG_RELEASE,
+    CONFIG_DEBUG,
+    CONFIG_PROFILE,
+    CONFIG_COUNT,
+} Config;
+
+static const char *config_names[CONFIG_COUNT] = {
+    [CONFIG_RELEASE] = "release",
+    [CONFIG_DEBUG] = "debug",
+    [CONFIG_PROFILE] = "profile",
+};
+
+static bool parse_config(const char *name, Config *config)
+{
+    for (Config i = 0; i < CONFIG_COUNT; i++)
+    {
+        if (strcmp(name, config_names[i]) == 0)
+        {
+            *config = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// used both when compiling and linking, since -flto and the sanitizers need to be on both
+static void append_config_flags(Cmd *cmd, Config config)
+{
+    switch (config)
+    {
+    case CONFIG_RELEASE:
+        cmd_append(cmd, "-O3", "-march=native", "-flto", "-DNDEBUG");
+        // raylib is already linked statically, the GL and X11 libraries can't be
+        cmd_append(cmd, "-static-libgcc");
+        break;
+    case CONFIG_DEBUG:
+        cmd_append(cmd, "-O0", "-g");
+        cmd_append(cmd, "-fsanitize=address,undefined", "-fno-omit-frame-pointer");
+        break;
+    case CONFIG_PROFILE:
+        cmd_append(cmd, "-O2", "-g");
+        cmd_append(cmd, "-fno-omit-frame-pointer", "-mno-omit-leaf-frame-pointer");
+        break;
+    case CONFIG_COUNT:
+        UNREACHABLE("append_config_flags");
+    }
+}
+
+static void append_raylib(Cmd *cmd)
+{
+    cmd_append(cmd, "-I" RAYLIB_DIR "include/");
+    cmd_append(cmd, "-L" RAYLIB_DIR "lib/");
+    cmd_append(cmd, "-l:libraylib.a");
+    cmd_append(cmd, "-lm");
+    cmd_append(cmd, "-lpthread");
+}
+
+// the sprite atlas and the images decoded into pixel arrays by embed_assets, only redone when an image or the tool
+// changed. The pixel arrays are compiled into an object of their own, so main.c is not compiled with them
+static bool build_assets(Cmd *cmd)
+{
+    const char *tool_path = BUILD_DIR "embed_assets";
+
+    if (!mkdir_if_not_exists(BUILD_DIR) || !mkdir_if_not_exists(ASSETS_DIR))
+    {
+        return false;
+    }
+
+    const char *tool_inputs[] = {"embed_assets.c", "nob.h", RAYLIB_DIR "lib/libraylib.a"};
+    int rebuild = needs_rebuild(tool_path, tool_inputs, ARRAY_LEN(tool_inputs));
+    if (rebuild < 0)
+    {
+        return false;
+    }
+    if (rebuild > 0)
+    {
+        cmd_append(cmd, "cc", "-fdiagnostics-color=always", "-Wall", "-Wextra", "-O2");
+        cmd_append(cmd, "-o", tool_path, "embed_assets.c");
+        append_raylib(cmd);
+        if (!cmd_run(cmd))
+        {
+            return false;
+        }
+    }
+
+    const char *asset_inputs[] = {tool_path, "resources/bg.jpg", "resources/apple.png", "resources/snake-graphics.png"};
+    rebuild = needs_rebuild(EMBEDDED_ASSETS_SOURCE, asset_inputs, ARRAY_LEN(asset_inputs));
+    if (rebuild < 0)
+    {
+        return false;
+    }
+    if (rebuild > 0)
+    {
+        cmd_append(cmd, tool_path, "resources", ASSETS_DIR);
+        if (!cmd_run(cmd))
+        {
+            return false;
+        }
+    }
+
+    rebuild = needs_rebuild1(EMBEDDED_ASSETS_OBJECT, EMBEDDED_ASSETS_SOURCE);
+    if (rebuild < 0)
+    {
+        return false;
+    }
+    if (rebuild == 0)
+    {
+        return true;
+    }
+
+    // nothing but data, the same object is linked into every configuration
+    cmd_append(cmd, "cc", "-fdiagnostics-color=always", "-Wall", "-Wextra");
+    cmd_append(cmd, "-c", "-o", EMBEDDED_ASSETS_OBJECT, EMBEDDED_ASSETS_SOURCE);
+    cmd_append(cmd, "-I" RAYLIB_DIR "include/");
+
+    return cmd_run(cmd);
+}
+
+static void append_main_build(Cmd *cmd, Config config, const char *output_path)
+{
+    cmd_append(cmd, "cc", "-fdiagnostics-color=always", "-Wall", "-Wextra");
+    append_config_flags(cmd, config);
+    cmd_append(cmd, "-o", output_path, "main.c", EMBEDDED_ASSETS_OBJECT);
+    cmd_append(cmd, "-I" ASSETS_DIR);
+    append_raylib(cmd);
+}
+
+static bool build_main(Cmd *cmd, Config config)
+{
+    const char *output_dir = temp_sprintf(BUILD_DIR "%s/", config_names[config]);
+    const char *output_path = temp_sprintf("%smain", output_dir);
+
+    if (!build_assets(cmd) || !mkdir_if_not_exists(output_dir))
+    {
+        return false;
+    }
+
+    const char *inputs[] = {"main.c", "nob.h", RAYLIB_DIR "lib/libraylib.a", ASSETS_DIR "/sprite_atlas.h",
+                            EMBEDDED_ASSETS_OBJECT};
+    int rebuild = needs_rebuild(output_path, inputs, ARRAY_LEN(inputs));
+    if (rebuild < 0)
+    {
+        return false;
+    }
+    if (rebuild == 0)
+    {
+        nob_log(INFO, "%s is up to date", output_path);
+        return true;
+    }
+
+    append_main_build(cmd, config, output_path);
+
+    return cmd_run(cmd);
+}
+
+// the bench scenarios of main: the built in autopilot, plus the recorded replays if there are any, without a window
+// so it also runs on machines without a display
+static void append_bench(Cmd *cmd, const char *program_path)
+{
+    cmd_append(cmd, program_path, "--bench", "--headless");
+    if (file_exists(REPLAYS_DIR) == 1)
+    {
+        cmd_append(cmd, REPLAYS_DIR);
+    }
+}
+
+typedef struct
+{
+    String_View name;
+    double ticks_per_second;
+    double frame_avg_ms;
+    double software_frame_avg_ms;
+} BenchLine;
+
+typedef struct
+{
+    BenchLine *items;
+    size_t count;
+    size_t capacity;
+} BenchLines;
+
+// `bench <name> key=value...` lines as printed by main --bench
+static bool read_bench_lines(const char *path, String_Builder *content, BenchLines *lines)
+{
+    if (!read_entire_file(path, content))
+    {
+        return false;
+    }
+
+    String_View rest = sb_to_sv(*content);
+    while (rest.count > 0)
+    {
+        String_View line = sv_chop_by_delim(&rest, '\n');
+        if (!sv_starts_with(line, sv_from_cstr("bench ")))
+        {
+            continue;
+        }
+        sv_chop_by_delim(&line, ' ');
+
+        BenchLine bench_line = {.name = sv_chop_by_delim(&line, ' ')};
+        while (line.count > 0)
+        {
+            String_View field = sv_chop_by_delim(&line, ' ');
+            String_View key = sv_chop_by_delim(&field, '=');
+            double value = strtod(temp_sv_to_cstr(field), NULL);
+
+            if (sv_eq(key, sv_from_cstr("ticks_per_second")))
+            {
+                bench_line.ticks_per_second = value;
+            }
+            else if (sv_eq(key, sv_from_cstr("frame_avg_ms")))
+            {
+                bench_line.frame_avg_ms = value;
+            }
+            else if (sv_eq(key, sv_from_cstr("software_frame_avg_ms")))
+            {
+                bench_line.software_frame_avg_ms = value;
+            }
+        }
+        da_append(lines, bench_line);
+    }
+
+    return true;
+}
+
+static double percent_change(double before, double after)
+{
+    return before > 0 ? (after - before) / before * 100.0 : 0.0;
+}
+
+// release build, instrumented build trained on the bench, optimized build, then both benched side by side
+static bool build_pgo(Cmd *cmd)
+{
+    if (!build_main(cmd, CONFIG_RELEASE))
+    {
+        return false;
+    }
+
+    if (!mkdir_if_not_exists(PGO_DIR))
+    {
+        return false;
+    }
+
+    // both steps have to produce the same output path, the profile data is named after it
+    const char *output_path = PGO_DIR "main";
+
+    append_main_build(cmd, CONFIG_RELEASE, output_path);
+    cmd_append(cmd, "-fprofile-generate", "-fprofile-update=atomic");
+    if (!cmd_run(cmd))
+    {
+        return false;
+    }
+
+    append_bench(cmd, output_path);
+    if (!cmd_run(cmd, .stdout_path = PGO_DIR "training.txt"))
+    {
+        return false;
+    }
+
+    append_main_build(cmd, CONFIG_RELEASE, output_path);
+    // code the bench never reached keeps being optimized as usual instead of for size
+    cmd_append(cmd, "-fprofile-use", "-fprofile-partial-training", "-Wno-missing-profile");
+    if (!cmd_run(cmd))
+    {
+        return false;
+    }
+
+    append_bench(cmd, BUILD_DIR "release/main");
+    if (!cmd_run(cmd, .stdout_path = PGO_DIR "release.txt"))
+    {
+        return false;
+    }
+
+    append_bench(cmd, output_path);
+    if (!cmd_run(cmd, .stdout_path = PGO_DIR "pgo.txt"))
+    {
+        return false;
+    }
+
+    String_Builder release_content = {0};
+    String_Builder pgo_content = {0};
+    BenchLines release_lines = {0};
+    BenchLines pgo_lines = {0};
+    if (!read_bench_lines(PGO_DIR "release.txt", &release_content, &release_lines) ||
+        !read_bench_lines(PGO_DIR "pgo.txt", &pgo_content, &pgo_lines))
+    {
+        return false;
+    }
+
+    da_foreach(BenchLine, before, &release_lines)
+    {
+        da_foreach(BenchLine, after, &pgo_lines)
+        {
+            if (!sv_eq(before->name, after->name))
+            {
+                continue;
+            }
+
+            nob_log(INFO, SV_Fmt ": %.0f -> %.0f ticks/s (%+.1f%%), %.4f -> %.4f ms/software frame (%+.1f%%)",
+                    SV_Arg(before->name), before->ticks_per_second, after->ticks_per_second,
+                    percent_change(before->ticks_per_second, after->ticks_per_second),
+                    before->software_frame_avg_ms, after->software_frame_avg_ms,
+                    percent_change(before->software_frame_avg_ms, after->software_frame_avg_ms));
+            // the bench runs headless, GPU frames are only timed with a window
+            if (before->frame_avg_ms > 0 && after->frame_avg_ms > 0)
+            {
+                nob_log(INFO, SV_Fmt ": %.4f -> %.4f ms/frame (%+.1f%%)", SV_Arg(before->name), before->frame_avg_ms,
+                        after->frame_avg_ms, percent_change(before->frame_avg_ms, after->frame_avg_ms));
+            }
+        }
+    }
+
+    da_free(release_lines);
+    da_free(pgo_lines);
+    sb_free(release_content);
+    sb_free(pgo_content);
+
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     NOB_GO_REBUILD_URSELF(argc, argv);
 
+    const char *program_name = shift(argv, argc);
+
     Cmd cmd = {0};
-    cmd_append(&cmd, "cc", "-fdiagnostics-color=always", "-Wall", "-Wextra");
-    cmd_append(&cmd, "-g");
-    cmd_append(&cmd, "-o", "main", "main.c");
-    cmd_append(&cmd, "-I./libs/raylib-5.5_linux_amd64/include/");
-    cmd_append(&cmd, "-L./libs/raylib-5.5_linux_amd64/lib/");
-    cmd_append(&cmd, "-l:libraylib.a");
-    cmd_append(&cmd, "-lm");
-    if (!cmd_run(&cmd))
+
+    Config config = CONFIG_RELEASE;
+    if (argc > 0)
+    {
+        const char *name = shift(argv, argc);
+        if (strcmp(name, "pgo") == 0)
+        {
+            return build_pgo(&cmd) ? 0 : 1;
+        }
+        if (!parse_config(name, &config))
+        {
+            nob_log(ERROR, "unknown configuration %s", name);
+            nob_log(INFO, "usage: %s [release|debug|profile|pgo]", program_name);
+            return 1;
+        }
+    }
+
+    if (!build_main(&cmd, config))
     {
         return 1;
     }